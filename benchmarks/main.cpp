@@ -0,0 +1,1189 @@
+#if defined(_WIN32)
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#   include <psapi.h>
+#   pragma comment(lib, "psapi.lib")
+#elif defined(__linux__)
+#   include <unistd.h>
+#   include <sys/ioctl.h>
+#   include <sys/syscall.h>
+#   include <linux/perf_event.h>
+#endif
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "abb.hpp"
+
+//--------------------------------------------------------------------------------------------------
+using namespace abb::units;
+
+
+//--------------------------------------------------------------------------------------------------
+// Returns the average time in nanoseconds of one call to op(i) for i in [0, count)
+template<typename _Op>
+double measure_ns_per_op(size_t count, _Op &&op)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        op(i);
+    }
+    const auto stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count() / count;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Deallocation latency of a cascading allocator as the number of nodes grows.
+// Every block is freed from the oldest node, the worst case for a list walk.
+void benchmark_cascading_allocator_deallocate()
+{
+    using node_alloc_t = abb::heap_linear_allocator<4_KiB>;
+    using alloc_t      = abb::cascading_allocator<node_alloc_t>;
+
+    // Two blocks fit in a node, the first one of each node can't be reclaimed by the linear allocator
+    // so deallocating it only costs the owner lookup, which is what we want to measure
+    constexpr size_t blockSize  = 1536_B;
+    constexpr size_t iterations = 100000;
+
+    std::printf("cascading_allocator deallocate\n");
+    std::printf("%10s %12s\n", "nodes", "ns/op");
+
+    for (size_t nodeCount : { 1, 4, 16, 64, 256, 1024 })
+    {
+        alloc_t allocator;
+        std::vector<abb::block> blocks(2 * nodeCount);
+        for (auto &b : blocks)
+        {
+            b = allocator.allocate(blockSize);
+        }
+
+        const auto oldest = blocks.front();
+        const auto ns = measure_ns_per_op(iterations, [&](size_t)
+        {
+            auto b = oldest;
+            allocator.deallocate(b);
+        });
+
+        std::printf("%10zu %12.2f\n", nodeCount, ns);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Runs op(threadIndex) on threadCount threads started together, returns the wall time in seconds
+template<typename _Op>
+double measure_parallel_seconds(size_t threadCount, _Op &&op)
+{
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&go, &op, t]
+        {
+            while (!go.load())
+            {
+                std::this_thread::yield();
+            }
+            op(t);
+        });
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    go = true;
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+    const auto stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Thread counts from 1 to the number of hardware threads (at least 32 to show high contention),
+// doubling each time
+std::vector<size_t> thread_counts()
+{
+    const size_t maxThreads = std::max(32u, std::thread::hardware_concurrency());
+    std::vector<size_t> counts;
+    for (size_t n = 1; n < maxThreads; n *= 2)
+    {
+        counts.push_back(n);
+    }
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Throughput of concurrent_linear_allocator as threads are added, every thread allocating
+// small blocks as fast as it can
+template<typename _Allocator>
+double concurrent_linear_allocator_mops(_Allocator &allocator, size_t threadCount, size_t allocationsPerThread)
+{
+    allocator.deallocateAll();
+    const auto seconds = measure_parallel_seconds(threadCount, [&](size_t)
+    {
+        for (size_t i = 0; i < allocationsPerThread; ++i)
+        {
+            auto b = allocator.allocate(16 + (i & 3) * 16);
+            if (!b.ptr)
+            {
+                std::abort();
+            }
+        }
+    });
+    return threadCount * allocationsPerThread / seconds / 1e6;
+}
+
+//--------------------------------------------------------------------------------------------------
+void benchmark_concurrent_linear_allocator_scaling()
+{
+    constexpr size_t maxAllocationsPerThread    = 200000;
+    constexpr size_t arenaSize                  = 512_MiB;
+    constexpr size_t leaseSize                  = 64_KiB;
+
+    using cas_alloc_t       = abb::concurrent_heap_linear_allocator<arenaSize>;
+    using fetch_add_alloc_t = abb::concurrent_heap_linear_allocator<arenaSize, 8_B, abb::mallocator, 0, abb::BumpMode::FetchAdd>;
+    using leased_alloc_t    = abb::concurrent_heap_linear_allocator<arenaSize, 8_B, abb::mallocator, leaseSize>;
+
+    cas_alloc_t       casAllocator;
+    fetch_add_alloc_t fetchAddAllocator;
+    leased_alloc_t    leasedAllocator;
+
+    std::printf("concurrent_linear_allocator scaling\n");
+    std::printf("%10s %14s %16s %14s\n", "threads", "CAS Mops/s", "fetch_add Mops/s", "leased Mops/s");
+
+    for (auto threadCount : thread_counts())
+    {
+        // Allocations take up to 64 bytes, each thread's share of the arena must hold all of them
+        // plus the lease tails it loses (less than a lease overall), so that the arena never runs
+        // out: past about 64 threads, each of them does fewer allocations
+        const auto allocationsPerThread = std::min(maxAllocationsPerThread, (arenaSize / threadCount - 2 * leaseSize) / 64);
+
+        const auto casMops      = concurrent_linear_allocator_mops(casAllocator, threadCount, allocationsPerThread);
+        const auto fetchAddMops = concurrent_linear_allocator_mops(fetchAddAllocator, threadCount, allocationsPerThread);
+        const auto leasedMops   = concurrent_linear_allocator_mops(leasedAllocator, threadCount, allocationsPerThread);
+        std::printf("%10zu %14.2f %16.2f %14.2f\n", threadCount, casMops, fetchAddMops, leasedMops);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+const char* to_string(abb::PageBacking backing)
+{
+    switch (backing)
+    {
+    case abb::PageBacking::HugePages:               return "huge pages";
+    case abb::PageBacking::TransparentHugePages:    return "transparent huge pages";
+    case abb::PageBacking::RegularPages:            return "regular pages";
+    default:                                        return "none";
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Fills the arena with pages then reads them at random, returns the average ns per read
+template<typename _Allocator>
+double random_access_ns(_Allocator &allocator)
+{
+    constexpr size_t pageSize = 4_KiB;
+    constexpr size_t reads    = 10000000;
+
+    std::vector<uint8_t*> pages;
+    for (auto b = allocator.allocate(pageSize); b.ptr; b = allocator.allocate(pageSize))
+    {
+        memset(b.ptr, static_cast<int>(pages.size()), b.size);
+        pages.push_back(static_cast<uint8_t*>(b.ptr));
+    }
+
+    // xorshift, cheap enough not to hide the memory accesses
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    size_t sum = 0;
+    const auto ns = measure_ns_per_op(reads, [&](size_t)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        sum += pages[state % pages.size()][(state >> 32) % pageSize];
+    });
+
+    // Keep the reads alive
+    if (sum == 0)
+    {
+        std::printf(" ");
+    }
+
+    allocator.deallocateAll();
+    return ns;
+}
+
+//--------------------------------------------------------------------------------------------------
+void benchmark_hugepage_random_access()
+{
+    constexpr size_t arenaSize = 1_GiB;
+
+    abb::heap_linear_allocator<arenaSize>       heapAllocator;
+    abb::hugepage_linear_allocator<arenaSize>   hugepageAllocator;
+
+    std::printf("random access over a %zu MiB arena\n", static_cast<size_t>(arenaSize / 1_MiB));
+    std::printf("%-50s %12s\n", "buffer provider", "ns/read");
+    std::printf("%-50s %12.2f\n", "heap_buffer_provider (mallocator)", random_access_ns(heapAllocator));
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "hugepage_buffer_provider (%s)", to_string(hugepageAllocator.backing()));
+    std::printf("%-50s %12.2f\n", name, random_access_ns(hugepageAllocator));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Times every allocation and deallocation of a random workload, one op at a time, and prints
+// the latency percentiles. The tail is what matters for allocators used in real time code.
+template<typename _Allocator>
+void print_latency_percentiles(const char *name, _Allocator &allocator)
+{
+    constexpr size_t slotCount  = 4096;
+    constexpr size_t operations = 1000000;
+
+    std::vector<abb::block> slots(slotCount, abb::block{ nullptr, 0 });
+    std::vector<uint32_t> latencies;
+    latencies.reserve(operations);
+
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < operations; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        // Mostly small sizes with a few big ones
+        auto &slot = slots[state % slotCount];
+        const auto size = (state >> 32) % 16 == 0 ? 16 + (state >> 40) % 8_KiB : 16 + (state >> 40) % 256;
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        if (slot.ptr)
+        {
+            allocator.deallocate(slot);
+            slot = abb::block{ nullptr, 0 };
+        }
+        else
+        {
+            slot = allocator.allocate(size);
+        }
+        const auto stop = std::chrono::high_resolution_clock::now();
+        latencies.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()));
+    }
+
+    for (auto &slot : slots)
+    {
+        allocator.deallocate(slot);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](double p)
+    {
+        return latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+    };
+    std::printf("%-30s %8u %8u %8u %8u %8u\n", name, percentile(0.5), percentile(0.99), percentile(0.999), percentile(0.9999), latencies.back());
+}
+
+//--------------------------------------------------------------------------------------------------
+void benchmark_allocation_latency()
+{
+    // Big enough for the whole live set
+    abb::heap_tlsf_allocator<64_MiB>        tlsfAllocator;
+    abb::heap_buddy_allocator<16_B, 22>     buddyAllocator;
+    abb::mallocator                         mallocator;
+
+    std::printf("allocation latency (ns)\n");
+    std::printf("%-30s %8s %8s %8s %8s %8s\n", "allocator", "p50", "p99", "p99.9", "p99.99", "max");
+    print_latency_percentiles("tlsf_allocator", tlsfAllocator);
+    print_latency_percentiles("buddy_allocator", buddyAllocator);
+    print_latency_percentiles("mallocator", mallocator);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Cost of finding the bucket of a size, the constexpr step_index against the bit scan based
+// fast_step_index, then of a whole bucketizer allocate/deallocate round trip
+template<typename _RangeRaider>
+void print_step_index_cost(const char *name, const std::vector<size_t> &sizes)
+{
+    constexpr size_t iterations = 10000000;
+
+    size_t sum = 0;
+    const auto slowNs = measure_ns_per_op(iterations, [&](size_t i)
+    {
+        sum += _RangeRaider::step_index(sizes[i % sizes.size()]);
+    });
+    const auto fastNs = measure_ns_per_op(iterations, [&](size_t i)
+    {
+        sum += _RangeRaider::fast_step_index(sizes[i % sizes.size()]);
+    });
+
+    // Keep the results alive
+    if (sum == 0)
+    {
+        std::printf(" ");
+    }
+
+    std::printf("%-30s %14.2f %14.2f\n", name, slowNs, fastNs);
+}
+
+//--------------------------------------------------------------------------------------------------
+void benchmark_bucketizer_dispatch()
+{
+    using pow2_t      = abb::pow2_range_raider<16_B, 4_KiB>;
+    using geometric_t = abb::geometric_range_raider<16_B, 4_KiB, 4>;
+
+    // Random sizes so that the branch predictor can't learn them
+    std::vector<size_t> sizes(4096);
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (auto &size : sizes)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        size = 16_B + state % (4_KiB - 16_B);
+    }
+
+    std::printf("bucketizer dispatch\n");
+    std::printf("%-30s %14s %14s\n", "range raider", "step_index ns", "fast ns");
+    print_step_index_cost<pow2_t>("pow2_range_raider", sizes);
+    print_step_index_cost<geometric_t>("geometric_range_raider", sizes);
+
+    using freelist_t = abb::freelist<abb::mallocator, abb::dynamic_range_t, 64, 8>;
+    abb::bucketizer<freelist_t, pow2_t> bucketizer;
+    const auto ns = measure_ns_per_op(10000000, [&](size_t i)
+    {
+        auto b = bucketizer.allocate(sizes[i % sizes.size()]);
+        bucketizer.deallocate(b);
+    });
+    std::printf("%-30s %14.2f\n", "bucketizer round trip", ns);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Batches of same size blocks, allocate_n against a loop of allocate
+template<typename _Allocator>
+void print_batch_cost(const char *name, _Allocator &allocator, size_t size)
+{
+    constexpr size_t batchSize  = 256;
+    constexpr size_t iterations = 20000;
+
+    std::vector<abb::block> blocks(batchSize);
+    const auto loopNs = measure_ns_per_op(iterations, [&](size_t)
+    {
+        abb::allocate_one_by_one(allocator, size, blocks.data(), batchSize);
+        abb::deallocate_one_by_one(allocator, blocks.data(), batchSize);
+    }) / batchSize;
+    const auto batchNs = measure_ns_per_op(iterations, [&](size_t)
+    {
+        abb::allocate_n(allocator, size, blocks.data(), batchSize);
+        abb::deallocate_n(allocator, blocks.data(), batchSize);
+    }) / batchSize;
+
+    std::printf("%-40s %12.2f %12.2f\n", name, loopNs, batchNs);
+}
+
+//--------------------------------------------------------------------------------------------------
+void benchmark_batch_allocation()
+{
+    using freelist_t   = abb::freelist<abb::mallocator, abb::dynamic_range_t, 512, 64>;
+    using bucketizer_t = abb::bucketizer<freelist_t, abb::pow2_range_raider<16_B, 4_KiB>>;
+
+    bucketizer_t                            bucketizer;
+    abb::locked_allocator<bucketizer_t>     lockedBucketizer;
+
+    std::printf("batch allocation of 256 blocks\n");
+    std::printf("%-40s %12s %12s\n", "allocator", "loop ns/blk", "batch ns/blk");
+    print_batch_cost("bucketizer<freelist>", bucketizer, 48);
+    print_batch_cost("locked_allocator<bucketizer<freelist>>", lockedBucketizer, 48);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Throughput of allocate/deallocate pairs as threads are added
+template<typename _Allocator>
+double allocation_pairs_mops(_Allocator &allocator, size_t threadCount, size_t pairsPerThread)
+{
+    const auto seconds = measure_parallel_seconds(threadCount, [&](size_t)
+    {
+        for (size_t i = 0; i < pairsPerThread; ++i)
+        {
+            auto b = allocator.allocate(16 + (i & 3) * 16);
+            *static_cast<volatile uint8_t*>(b.ptr) = 0;
+            allocator.deallocate(b);
+        }
+    });
+    return threadCount * pairsPerThread / seconds / 1e6;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Cost of keeping statistics on a thread safe allocator: plain counters behind a lock against a
+// shard per thread
+void benchmark_sharded_stats()
+{
+    constexpr size_t pairsPerThread = 1000000;
+
+    using locked_stats_t  = abb::locked_allocator<abb::stats_collector<abb::mallocator>>;
+    using sharded_stats_t = abb::stats_collector<abb::mallocator, abb::all_stats, abb::sharded_stats<>>;
+
+    abb::mallocator mallocator;
+    locked_stats_t  lockedStats;
+    sharded_stats_t shardedStats;
+
+    // The overhead is the time the statistics add to each allocation and deallocation pair
+    std::printf("statistics on mallocator\n");
+    std::printf("%10s %14s %16s %16s %16s %16s\n", "threads", "none Mops/s", "locked Mops/s", "sharded Mops/s", "locked +ns/pair", "sharded +ns/pair");
+
+    for (auto threadCount : thread_counts())
+    {
+        const auto noneMops     = allocation_pairs_mops(mallocator, threadCount, pairsPerThread);
+        const auto lockedMops   = allocation_pairs_mops(lockedStats, threadCount, pairsPerThread);
+        const auto shardedMops  = allocation_pairs_mops(shardedStats, threadCount, pairsPerThread);
+        std::printf("%10zu %14.2f %16.2f %16.2f %16.2f %16.2f\n", threadCount, noneMops, lockedMops, shardedMops,
+            1e3 / lockedMops - 1e3 / noneMops, 1e3 / shardedMops - 1e3 / noneMops);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Counts the instructions retired by the calling thread, where the platform lets us
+// (perf events on Linux), -1 otherwise
+class instruction_counter
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    instruction_counter()
+    {
+#if defined(__linux__)
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.size           = sizeof(attr);
+        attr.config         = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    //----------------------------------------------------------------------------------------------
+    ~instruction_counter()
+    {
+#if defined(__linux__)
+        if (fd_ >= 0)
+        {
+            close(fd_);
+        }
+#endif
+    }
+
+    //----------------------------------------------------------------------------------------------
+    void start()
+    {
+#if defined(__linux__)
+        if (fd_ >= 0)
+        {
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    //----------------------------------------------------------------------------------------------
+    long long stop()
+    {
+#if defined(__linux__)
+        long long count = 0;
+        if (fd_ >= 0)
+        {
+            ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd_, &count, sizeof(count)) == sizeof(count))
+            {
+                return count;
+            }
+        }
+#endif
+        return -1;
+    }
+
+private:
+    //----------------------------------------------------------------------------------------------
+    int fd_ = -1;
+};
+
+//--------------------------------------------------------------------------------------------------
+// Resets the peak resident set size of the process where the platform lets us (Linux), the peak
+// then only covers what runs next
+void reset_peak_rss()
+{
+#if defined(__linux__)
+    if (auto pFile = std::fopen("/proc/self/clear_refs", "w"))
+    {
+        std::fputs("5", pFile);
+        std::fclose(pFile);
+    }
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+// Peak resident set size of the process in KiB, 0 if unknown
+size_t peak_rss_kib()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return counters.PeakWorkingSetSize / 1_KiB;
+    }
+#elif defined(__linux__)
+    if (auto pFile = std::fopen("/proc/self/status", "r"))
+    {
+        char line[256];
+        size_t peak = 0;
+        while (std::fgets(line, sizeof(line), pFile))
+        {
+            if (std::sscanf(line, "VmHWM: %zu kB", &peak) == 1)
+            {
+                break;
+            }
+        }
+        std::fclose(pFile);
+        return peak;
+    }
+#endif
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+template<typename _Allocator, typename = void>
+struct has_deallocate_all : std::false_type {};
+
+//--------------------------------------------------------------------------------------------------
+template<typename _Allocator>
+struct has_deallocate_all<_Allocator, std::void_t<decltype(std::declval<_Allocator&>().deallocateAll())>> : std::true_type {};
+
+//--------------------------------------------------------------------------------------------------
+enum class Pattern
+{
+    // Freed in reverse order of allocation
+    LIFO,
+    // Freed in order of allocation
+    FIFO,
+    // Freed in random order
+    RandomFree,
+    // Every block grows 16 bytes at a time with reallocate, then everything is freed
+    ReallocGrowth,
+};
+
+//--------------------------------------------------------------------------------------------------
+const char* to_string(Pattern pattern)
+{
+    switch (pattern)
+    {
+    case Pattern::LIFO:             return "lifo";
+    case Pattern::FIFO:             return "fifo";
+    case Pattern::RandomFree:       return "random_free";
+    case Pattern::ReallocGrowth:    return "realloc_growth";
+    default:                        return "none";
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+struct suite_result
+{
+    std::string composition;
+    std::string pattern;
+    double      nsPerOp;
+    // Instructions per operation, negative if they couldn't be counted
+    double      instructionsPerOp;
+    size_t      peakRssKiB;
+};
+
+//--------------------------------------------------------------------------------------------------
+// Runs the pattern for a few rounds of blockCount blocks of 16 to 256 bytes, the allocator
+// gives everything back between rounds if it can
+template<typename _Allocator>
+suite_result run_pattern(const char *composition, _Allocator &allocator, Pattern pattern)
+{
+    constexpr size_t blockCount = 4096;
+    constexpr size_t rounds     = 50;
+
+    std::mt19937_64 random(42);
+    std::vector<size_t> sizes(blockCount);
+    std::vector<size_t> freeOrder(blockCount);
+    for (size_t i = 0; i < blockCount; ++i)
+    {
+        sizes[i]     = 16 + random() % 241;
+        freeOrder[i] = (pattern == Pattern::LIFO) ? blockCount - 1 - i : i;
+    }
+    if (pattern == Pattern::RandomFree)
+    {
+        std::shuffle(freeOrder.begin(), freeOrder.end(), random);
+    }
+
+    std::vector<abb::block> blocks(blockCount, abb::block{ nullptr, 0 });
+    size_t operations = 0;
+
+    reset_peak_rss();
+    instruction_counter instructions;
+    instructions.start();
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        if (pattern == Pattern::ReallocGrowth)
+        {
+            for (size_t i = 0; i < blockCount; ++i)
+            {
+                blocks[i] = allocator.allocate(16);
+                for (size_t size = 32; size <= sizes[i]; size += 16)
+                {
+                    allocator.reallocate(blocks[i], size);
+                    ++operations;
+                }
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < blockCount; ++i)
+            {
+                blocks[i] = allocator.allocate(sizes[i]);
+            }
+        }
+
+        for (auto i : freeOrder)
+        {
+            allocator.deallocate(blocks[i]);
+        }
+        operations += 2 * blockCount;
+
+        if constexpr (has_deallocate_all<_Allocator>::value)
+        {
+            allocator.deallocateAll();
+        }
+    }
+    const auto stop = std::chrono::high_resolution_clock::now();
+    const auto instructionCount = instructions.stop();
+
+    suite_result result;
+    result.composition          = composition;
+    result.pattern              = to_string(pattern);
+    result.nsPerOp              = std::chrono::duration<double, std::nano>(stop - start).count() / operations;
+    result.instructionsPerOp    = instructionCount < 0 ? -1.0 : double(instructionCount) / operations;
+    result.peakRssKiB           = peak_rss_kib();
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+template<typename _Allocator>
+void run_all_patterns(const char *composition, std::vector<suite_result> &results)
+{
+    for (auto pattern : { Pattern::LIFO, Pattern::FIFO, Pattern::RandomFree, Pattern::ReallocGrowth })
+    {
+        // A fresh allocator for each pattern, they don't all give back their memory
+        auto pAllocator = std::make_unique<_Allocator>();
+        results.push_back(run_pattern(composition, *pAllocator, pattern));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Results of a previous run written with --csv, by composition and pattern
+std::map<std::string, suite_result> read_baseline(const char *path)
+{
+    std::map<std::string, suite_result> baseline;
+    if (auto pFile = std::fopen(path, "r"))
+    {
+        char composition[128];
+        char pattern[64];
+        suite_result r;
+        // Skip the header line
+        std::fscanf(pFile, "%*[^\n]\n");
+        while (std::fscanf(pFile, "%127[^,],%63[^,],%lf,%lf,%zu\n", composition, pattern, &r.nsPerOp, &r.instructionsPerOp, &r.peakRssKiB) == 5)
+        {
+            r.composition = composition;
+            r.pattern     = pattern;
+            baseline[r.composition + "/" + r.pattern] = r;
+        }
+        std::fclose(pFile);
+    }
+    return baseline;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Every compositor under the standard patterns, against malloc.
+// With a csv path the results are also written there, with a baseline path (a csv written by a
+// previous run) the time of each benchmark is compared to the baseline's.
+void benchmark_compositor_suite(const char *csvPath, const char *baselinePath)
+{
+    using namespace abb;
+
+    using linear_t              = heap_linear_allocator<64_MiB>;
+    using concurrent_linear_t   = concurrent_heap_linear_allocator<64_MiB>;
+    using freelist_t            = freelist<mallocator, range_t<16_B, 256_B>, 4096, 64>;
+    using buckets_t             = bucketizer<freelist<mallocator, dynamic_range_t, 1024, 64>, pow2_range_raider<16_B, 256_B>>;
+    using segregator_t          = segregator<128_B, bucketizer<freelist<mallocator, dynamic_range_t, 1024, 64>, pow2_range_raider<16_B, 128_B>>, mallocator>;
+    using fallback_t            = fallback_allocator<heap_linear_allocator<256_KiB>, heap_linear_allocator<64_MiB>>;
+    using cascading_t           = cascading_allocator<heap_linear_allocator<1_MiB>>;
+    using affix_t               = affix_allocator<mallocator, size_t>;
+
+    std::vector<suite_result> results;
+    run_all_patterns<mallocator>("mallocator", results);
+    run_all_patterns<linear_t>("linear_allocator", results);
+    run_all_patterns<concurrent_linear_t>("concurrent_linear_allocator", results);
+    run_all_patterns<freelist_t>("freelist", results);
+    run_all_patterns<buckets_t>("bucketizer", results);
+    run_all_patterns<segregator_t>("segregator", results);
+    run_all_patterns<fallback_t>("fallback_allocator", results);
+    run_all_patterns<cascading_t>("cascading_allocator", results);
+    run_all_patterns<affix_t>("affix_allocator", results);
+
+    const auto baseline = baselinePath ? read_baseline(baselinePath) : std::map<std::string, suite_result>();
+
+    std::printf("compositor suite\n");
+    std::printf("%-28s %-16s %10s %10s %14s %12s\n", "composition", "pattern", "ns/op", "instr/op", "peak RSS KiB", "vs baseline");
+    for (const auto &r : results)
+    {
+        char versus[32] = "";
+        const auto it = baseline.find(r.composition + "/" + r.pattern);
+        if (it != baseline.end() && it->second.nsPerOp > 0)
+        {
+            std::snprintf(versus, sizeof(versus), "%+.1f%%", 100.0 * (r.nsPerOp / it->second.nsPerOp - 1.0));
+        }
+        char instructions[32] = "n/a";
+        if (r.instructionsPerOp >= 0)
+        {
+            std::snprintf(instructions, sizeof(instructions), "%.1f", r.instructionsPerOp);
+        }
+        std::printf("%-28s %-16s %10.2f %10s %14zu %12s\n", r.composition.c_str(), r.pattern.c_str(), r.nsPerOp, instructions, r.peakRssKiB, versus);
+    }
+
+    if (csvPath)
+    {
+        if (auto pFile = std::fopen(csvPath, "w"))
+        {
+            std::fprintf(pFile, "composition,pattern,ns_per_op,instructions_per_op,peak_rss_kib\n");
+            for (const auto &r : results)
+            {
+                std::fprintf(pFile, "%s,%s,%.3f,%.3f,%zu\n", r.composition.c_str(), r.pattern.c_str(), r.nsPerOp, r.instructionsPerOp, r.peakRssKiB);
+            }
+            std::fclose(pFile);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Times one operation out of sample_period, timing them all would cost more than the operations
+class latency_sampler
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    static constexpr size_t sample_period = 64;
+
+public:
+    //----------------------------------------------------------------------------------------------
+    template<typename _Op>
+    auto operator()(_Op &&op)
+    {
+        if (++count_ % sample_period != 0)
+        {
+            return op();
+        }
+
+        const auto start  = std::chrono::high_resolution_clock::now();
+        const auto result = op();
+        const auto stop   = std::chrono::high_resolution_clock::now();
+        samples_.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()));
+        return result;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    size_t                  count_ = 0;
+    std::vector<uint32_t>   samples_;
+};
+
+//--------------------------------------------------------------------------------------------------
+// Sizes of 16 to 256 bytes, mostly small ones
+inline size_t random_size(uint64_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (state >> 32) % 4 == 0 ? 16 + (state >> 40) % 241 : 16 + (state >> 40) % 49;
+}
+
+//--------------------------------------------------------------------------------------------------
+struct scalability_result
+{
+    double      mops;
+    uint32_t    p50;
+    uint32_t    p99;
+    uint32_t    p999;
+};
+
+//--------------------------------------------------------------------------------------------------
+// Merges the latency samples of every thread
+scalability_result to_scalability_result(size_t operations, double seconds, std::vector<latency_sampler> &samplers)
+{
+    std::vector<uint32_t> samples;
+    for (auto &sampler : samplers)
+    {
+        samples.insert(samples.end(), sampler.samples_.begin(), sampler.samples_.end());
+    }
+    std::sort(samples.begin(), samples.end());
+    const auto percentile = [&samples](double p)
+    {
+        return samples.empty() ? 0u : samples[static_cast<size_t>(p * (samples.size() - 1))];
+    };
+    return scalability_result{ operations / seconds / 1e6, percentile(0.5), percentile(0.99), percentile(0.999) };
+}
+
+//--------------------------------------------------------------------------------------------------
+// threadtest: each thread allocates a batch of blocks then frees them all, over and over
+template<typename _Allocator>
+scalability_result threadtest(_Allocator &allocator, size_t threadCount)
+{
+    constexpr size_t rounds     = 100;
+    constexpr size_t batchSize  = 1000;
+
+    std::vector<latency_sampler> samplers(threadCount);
+    const auto seconds = measure_parallel_seconds(threadCount, [&](size_t t)
+    {
+        auto &sample = samplers[t];
+        std::vector<abb::block> blocks(batchSize);
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            for (auto &b : blocks)
+            {
+                b = sample([&] { return allocator.allocate(64); });
+            }
+            for (auto &b : blocks)
+            {
+                sample([&] { allocator.deallocate(b); return 0; });
+            }
+        }
+    });
+    return to_scalability_result(threadCount * rounds * batchSize * 2, seconds, samplers);
+}
+
+//--------------------------------------------------------------------------------------------------
+// larson: each thread replaces random blocks of its own slots with blocks of random sizes, then
+// the next generation of threads takes over the slots of the previous one, shifted by one, so
+// that blocks keep being freed by other threads than the ones that allocated them
+template<typename _Allocator>
+scalability_result larson(_Allocator &allocator, size_t threadCount)
+{
+    constexpr size_t generations            = 8;
+    constexpr size_t slotsPerThread         = 1000;
+    constexpr size_t replacementsPerThread  = 20000;
+
+    std::vector<abb::block> slots(threadCount * slotsPerThread);
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for (auto &slot : slots)
+    {
+        slot = allocator.allocate(random_size(seed));
+    }
+
+    std::vector<latency_sampler> samplers(threadCount);
+    double seconds = 0;
+    for (size_t generation = 0; generation < generations; ++generation)
+    {
+        seconds += measure_parallel_seconds(threadCount, [&](size_t t)
+        {
+            auto &sample = samplers[t];
+            auto *pSlots = slots.data() + ((t + generation) % threadCount) * slotsPerThread;
+            uint64_t state = 0x9E3779B97F4A7C15ull + t + generation * threadCount;
+            for (size_t i = 0; i < replacementsPerThread; ++i)
+            {
+                auto &slot = pSlots[random_size(state) % slotsPerThread];
+                sample([&] { allocator.deallocate(slot); return 0; });
+                slot = sample([&] { return allocator.allocate(random_size(state)); });
+            }
+        });
+    }
+
+    for (auto &slot : slots)
+    {
+        allocator.deallocate(slot);
+    }
+    return to_scalability_result(generations * threadCount * replacementsPerThread * 2, seconds, samplers);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Single producer single consumer ring of blocks
+class block_ring
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    static constexpr size_t capacity = 1024;
+
+public:
+    //----------------------------------------------------------------------------------------------
+    bool push(const abb::block &b)
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == capacity)
+        {
+            return false;
+        }
+        blocks_[tail % capacity] = b;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool pop(abb::block &b)
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        b = blocks_[head % capacity];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    //----------------------------------------------------------------------------------------------
+    alignas(64) std::atomic<size_t> head_{ 0 };
+    alignas(64) std::atomic<size_t> tail_{ 0 };
+    abb::block                      blocks_[capacity];
+};
+
+//--------------------------------------------------------------------------------------------------
+// producer-consumer: threads go by pairs, one allocates blocks and hands them to the other one
+// which frees them, every deallocation is a cross-thread free (even thread counts only)
+template<typename _Allocator>
+scalability_result producer_consumer(_Allocator &allocator, size_t threadCount)
+{
+    constexpr size_t blocksPerPair = 200000;
+
+    assert(threadCount >= 2 && threadCount % 2 == 0);
+    const size_t pairCount = threadCount / 2;
+    std::vector<block_ring> rings(pairCount);
+    std::vector<latency_sampler> samplers(pairCount * 2);
+    const auto seconds = measure_parallel_seconds(pairCount * 2, [&](size_t t)
+    {
+        auto &sample = samplers[t];
+        auto &ring   = rings[t / 2];
+        uint64_t state = 0x9E3779B97F4A7C15ull + t;
+        for (size_t i = 0; i < blocksPerPair; ++i)
+        {
+            if (t % 2 == 0)
+            {
+                const auto b = sample([&] { return allocator.allocate(random_size(state)); });
+                while (!ring.push(b))
+                {
+                    std::this_thread::yield();
+                }
+            }
+            else
+            {
+                abb::block b;
+                while (!ring.pop(b))
+                {
+                    std::this_thread::yield();
+                }
+                sample([&] { allocator.deallocate(b); return 0; });
+            }
+        }
+    });
+    return to_scalability_result(pairCount * blocksPerPair * 2, seconds, samplers);
+}
+
+//--------------------------------------------------------------------------------------------------
+// burst-then-idle: each thread allocates a burst of blocks, frees them, then sleeps. The
+// throughput only counts the bursts, the tail shows what the first allocations after a pause
+// cost (cold caches, memory given back while idle)
+template<typename _Allocator>
+scalability_result burst_then_idle(_Allocator &allocator, size_t threadCount)
+{
+    constexpr size_t bursts     = 20;
+    constexpr size_t burstSize  = 5000;
+
+    std::vector<latency_sampler> samplers(threadCount);
+    std::vector<double> busySeconds(threadCount, 0.0);
+    measure_parallel_seconds(threadCount, [&](size_t t)
+    {
+        auto &sample = samplers[t];
+        std::vector<abb::block> blocks(burstSize);
+        uint64_t state = 0x9E3779B97F4A7C15ull + t;
+        for (size_t burst = 0; burst < bursts; ++burst)
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (auto &b : blocks)
+            {
+                b = sample([&] { return allocator.allocate(random_size(state)); });
+            }
+            for (auto &b : blocks)
+            {
+                sample([&] { allocator.deallocate(b); return 0; });
+            }
+            const auto stop = std::chrono::high_resolution_clock::now();
+            busySeconds[t] += std::chrono::duration<double>(stop - start).count();
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    });
+
+    // Bursts overlap as much as the cores allow
+    const size_t parallelism = std::max<size_t>(1, std::min<size_t>(threadCount, std::thread::hardware_concurrency()));
+    double seconds = 0;
+    for (auto busy : busySeconds)
+    {
+        seconds += busy / parallelism;
+    }
+    return to_scalability_result(threadCount * bursts * burstSize * 2, seconds, samplers);
+}
+
+//--------------------------------------------------------------------------------------------------
+template<typename _Allocator, typename _Workload>
+void print_scalability(const char *workload, const char *composition, const std::vector<size_t> &threadCounts, _Workload &&runWorkload)
+{
+    for (auto threadCount : threadCounts)
+    {
+        // A fresh allocator for each run
+        auto pAllocator = std::make_unique<_Allocator>();
+        const auto r = runWorkload(*pAllocator, threadCount);
+        std::printf("%-18s %-28s %8zu %10.2f %8u %8u %8u\n", workload, composition, threadCount, r.mops, r.p50, r.p99, r.p999);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+template<typename _Allocator>
+void print_all_workloads(const char *composition)
+{
+    const auto threadCounts = thread_counts();
+
+    // Producers and consumers go by pairs
+    std::vector<size_t> pairedThreadCounts;
+    std::copy_if(threadCounts.begin(), threadCounts.end(), std::back_inserter(pairedThreadCounts), [](size_t n) { return n % 2 == 0; });
+
+    print_scalability<_Allocator>("threadtest", composition, threadCounts, [](_Allocator &a, size_t n) { return threadtest(a, n); });
+    print_scalability<_Allocator>("larson", composition, threadCounts, [](_Allocator &a, size_t n) { return larson(a, n); });
+    print_scalability<_Allocator>("producer_consumer", composition, pairedThreadCounts, [](_Allocator &a, size_t n) { return producer_consumer(a, n); });
+    print_scalability<_Allocator>("burst_then_idle", composition, threadCounts, [](_Allocator &a, size_t n) { return burst_then_idle(a, n); });
+}
+
+//--------------------------------------------------------------------------------------------------
+// Classic multithreaded allocator workloads on the thread safe compositions, from 1 thread to
+// the number of hardware threads. Latencies are sampled, one operation out of 64.
+void benchmark_multithreaded_scalability()
+{
+    using namespace abb;
+
+    using freelist_t        = freelist<mallocator, dynamic_range_t, 1024, 64>;
+    using locked_buckets_t  = locked_allocator<bucketizer<freelist_t, pow2_range_raider<16_B, 256_B>>>;
+    using thread_cache_t    = thread_cache<locked_buckets_t, pow2_range_raider<16_B, 256_B>, 64>;
+    using concurrent_fl_t   = segregator<64_B, concurrent_freelist<aligned_mallocator<16>, range_t<16_B, 64_B>, 4096, 64>, mallocator>;
+
+    std::printf("multithreaded scalability\n");
+    std::printf("%-18s %-28s %8s %10s %8s %8s %8s\n", "workload", "composition", "threads", "Mops/s", "p50 ns", "p99 ns", "p99.9 ns");
+    print_all_workloads<mallocator>("mallocator");
+    print_all_workloads<locked_buckets_t>("locked_allocator<bucketizer>");
+    print_all_workloads<thread_cache_t>("thread_cache<locked>");
+    print_all_workloads<concurrent_fl_t>("segregator<concurrent_fl>");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Builds then destroys a list, a hash map and a vector of strings on the resource, calling
+// endRound after each round. Returns the average time of a round in microseconds.
+template<typename _EndRound>
+double pmr_containers_us(std::pmr::memory_resource &resource, _EndRound &&endRound)
+{
+    constexpr size_t rounds         = 50;
+    constexpr int    elementCount   = 10000;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        {
+            std::pmr::list<int> l(&resource);
+            std::pmr::unordered_map<int, int> m(&resource);
+            std::pmr::vector<std::pmr::string> v(&resource);
+            for (int i = 0; i < elementCount; ++i)
+            {
+                l.push_back(i);
+                m[i] = i;
+                if (i % 10 == 0)
+                {
+                    v.emplace_back(64, 'x');
+                }
+            }
+        }
+        endRound();
+    }
+    const auto stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(stop - start).count() / rounds;
+}
+
+//--------------------------------------------------------------------------------------------------
+// abb compositions behind std::pmr against the standard resources: linear allocator against
+// monotonic buffer, both released after each round, and freelist pools against the pool resource
+void benchmark_memory_resource()
+{
+    using small_t       = abb::freelist<abb::mallocator, abb::range_t<0, 16_B>, 1024, 16>;
+    using freelist_t    = abb::freelist<abb::mallocator, abb::dynamic_range_t, 1024, 8>;
+    using pool_t        = abb::segregator<16_B, small_t, abb::bucketizer<freelist_t, abb::pow2_range_raider<16_B, 256_KiB>>>;
+    using arena_t       = abb::heap_linear_allocator<8_MiB, 16_B>;
+
+    std::pmr::monotonic_buffer_resource     monotonic;
+    std::pmr::unsynchronized_pool_resource  stdPool;
+    auto pArena = std::make_unique<abb::memory_resource<arena_t>>();
+    auto pPool  = std::make_unique<abb::memory_resource<pool_t>>();
+
+    std::printf("std::pmr containers, one round builds and destroys a list, a map and strings\n");
+    std::printf("%-40s %12s\n", "resource", "us/round");
+    std::printf("%-40s %12.1f\n", "monotonic_buffer_resource", pmr_containers_us(monotonic, [&] { monotonic.release(); }));
+    std::printf("%-40s %12.1f\n", "memory_resource<heap_linear_allocator>", pmr_containers_us(*pArena, [&] { pArena->release(); }));
+    std::printf("%-40s %12.1f\n", "unsynchronized_pool_resource", pmr_containers_us(stdPool, [] {}));
+    std::printf("%-40s %12.1f\n", "memory_resource<bucketizer<freelist>>", pmr_containers_us(*pPool, [] {}));
+    std::printf("%-40s %12.1f\n", "new_delete_resource", pmr_containers_us(*std::pmr::new_delete_resource(), [] {}));
+}
+
+//--------------------------------------------------------------------------------------------------
+// usage: abb_benchmarks [--csv <results.csv>] [--baseline <previous results.csv>]
+int main(int argc, char **argv)
+{
+    const char *csvPath      = nullptr;
+    const char *baselinePath = nullptr;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--csv") == 0)
+        {
+            csvPath = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--baseline") == 0)
+        {
+            baselinePath = argv[i + 1];
+        }
+    }
+
+    benchmark_cascading_allocator_deallocate();
+    benchmark_concurrent_linear_allocator_scaling();
+    benchmark_hugepage_random_access();
+    benchmark_allocation_latency();
+    benchmark_bucketizer_dispatch();
+    benchmark_batch_allocation();
+    benchmark_sharded_stats();
+    benchmark_compositor_suite(csvPath, baselinePath);
+    benchmark_multithreaded_scalability();
+    benchmark_memory_resource();
+
+    return EXIT_SUCCESS;
+}
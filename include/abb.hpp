@@ -6,16 +6,33 @@
 #include "abb/units.hpp"
 #include "abb/range_helpers.hpp"
 #include "abb/buffer_provider.hpp"
+#include "abb/virtual_buffer_provider.hpp"
+#include "abb/hugepage_buffer_provider.hpp"
+#include "abb/batch_helpers.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
 #include "abb/reallocation_helpers.hpp"
+#include "abb/sharded_stats.hpp"
+#include "abb/stl_allocator.hpp"
+#include "abb/memory_resource.hpp"
 // Compositors
 #include "abb/stamp.hpp"
+#include "abb/stats_collector.hpp"
+#include "abb/trace_recorder.hpp"
 #include "abb/freelist.hpp"
+#include "abb/slab_allocator.hpp"
 #include "abb/bucketizer.hpp"
+#include "abb/buddy_allocator.hpp"
+#include "abb/tlsf_allocator.hpp"
 #include "abb/segregator.hpp"
+#include "abb/thread_cache.hpp"
 #include "abb/affix_allocator.hpp"
+#include "abb/bitmapped_block.hpp"
 #include "abb/linear_allocator.hpp"
+#include "abb/locked_allocator.hpp"
 #include "abb/fallback_allocator.hpp"
 #include "abb/cascading_allocator.hpp"
+#include "abb/concurrent_freelist.hpp"
 #include "abb/concurrent_linear_allocator.hpp"
 // Allocators
 #include "abb/mallocator.hpp"
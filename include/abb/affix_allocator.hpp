@@ -1,7 +1,12 @@
 #pragma once
 
+#include <limits>
+
 #include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
 #include "abb/reallocation_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
 
 
 namespace abb {
@@ -28,13 +33,23 @@ namespace abb {
         //------------------------------------------------------------------------------------------
         static_assert(!(prefix_size == 0 && suffix_size == 0), "Pointless affix_allocator detected.");
 
+    private:
+        //------------------------------------------------------------------------------------------
+        // Bigger sizes would wrap around once affixed
+        static constexpr size_t max_size = std::numeric_limits<size_t>::max() - prefix_size - suffix_size;
+
     public:
         //------------------------------------------------------------------------------------------
         block allocate(size_t size)
         {
+            if (size > max_size)
+            {
+                return block{ nullptr, 0 };
+            }
+
             const auto affixedSize  = prefix_size + size + suffix_size;
             const auto affixedBlock = _Allocator::allocate(affixedSize);
-            return toStrippedBlock(affixedBlock);
+            return affixedBlock.ptr ? toStrippedBlock(affixedBlock) : block{ nullptr, 0 };
         }
 
         //------------------------------------------------------------------------------------------
@@ -52,9 +67,54 @@ namespace abb {
                 return true;
             }
 
+            // Try to grow in place first
+            if (newSize > strippedBlock.size && expand(strippedBlock, newSize - strippedBlock.size))
+            {
+                return true;
+            }
+
             return reallocate_and_copy(*this, *this, strippedBlock, newSize);
         }
 
+        //------------------------------------------------------------------------------------------
+        // The suffix is moved to the new end of the block
+        bool expand(block &strippedBlock, size_t delta)
+        {
+            auto affixedBlock = toAffixedBlock(strippedBlock);
+            const auto pOldSuffix = static_cast<uint8_t*>(strippedBlock.ptr) + strippedBlock.size;
+            if (!abb::expand(static_cast<_Allocator&>(*this), affixedBlock, delta))
+            {
+                return false;
+            }
+
+            strippedBlock = toStrippedBlock(affixedBlock);
+            if (suffix_size != 0)
+            {
+                std::memmove(static_cast<uint8_t*>(strippedBlock.ptr) + strippedBlock.size, pOldSuffix, suffix_size);
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        constexpr size_t good_size(size_t size) const
+        {
+            return abb::good_size(static_cast<const _Allocator&>(*this), prefix_size + size + suffix_size) - prefix_size - suffix_size;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The stripped block keeps the alignment of the affixed one only if the prefix does
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            if (size > max_size || !is_aligned(prefix_size, blockAlignment))
+            {
+                return block{ nullptr, 0 };
+            }
+
+            const auto affixedSize  = prefix_size + size + suffix_size;
+            const auto affixedBlock = abb::allocate_aligned(static_cast<_Allocator&>(*this), affixedSize, blockAlignment);
+            return affixedBlock.ptr ? toStrippedBlock(affixedBlock) : block{ nullptr, 0 };
+        }
+
         //------------------------------------------------------------------------------------------
         bool owns(const block &strippedBlock) const
         {
@@ -62,6 +122,31 @@ namespace abb {
             return _Allocator::owns(affixedBlock);
         }
 
+    public:
+        //------------------------------------------------------------------------------------------
+        // Batch interface
+        size_t allocate_n(size_t size, block *strippedBlocks, size_t count)
+        {
+            const auto affixedSize = prefix_size + size + suffix_size;
+            const auto allocated   = abb::allocate_n(static_cast<_Allocator&>(*this), affixedSize, strippedBlocks, count);
+            for (size_t i = 0; i < allocated; ++i)
+            {
+                strippedBlocks[i] = toStrippedBlock(strippedBlocks[i]);
+            }
+            return allocated;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The blocks are turned back into affixed blocks in place
+        void deallocate_n(block *strippedBlocks, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                strippedBlocks[i] = toAffixedBlock(strippedBlocks[i]);
+            }
+            abb::deallocate_n(static_cast<_Allocator&>(*this), strippedBlocks, count);
+        }
+
     private:
         //------------------------------------------------------------------------------------------
         block toAffixedBlock(const block &strippedBlock) const
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cassert>
+#include <type_traits>
+
+#include "abb/block.hpp"
+#include "abb/bit_helpers.hpp"
+
+
+namespace abb {
+
+    namespace details {
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocator, typename = void>
+        struct has_allocate_aligned : std::false_type {};
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocator>
+        struct has_allocate_aligned<_Allocator, std::void_t<decltype(std::declval<_Allocator&>().allocate_aligned(size_t{}, size_t{}))>>
+            : std::true_type {};
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Whether the allocator can align a block more than its static alignment
+    template<typename _Allocator>
+    inline constexpr bool supports_allocate_aligned()
+    {
+        return details::has_allocate_aligned<_Allocator>::value;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Allocates size bytes aligned on blockAlignment, a power of 2, the block is then owned and
+    // deallocated as any other one.
+    // Alignments up to the allocator's own one are a plain allocation, bigger ones need the
+    // allocator to have an allocate_aligned member, the allocation fails otherwise.
+    //
+    // Compositors that inherit from the allocators they compose must define their own
+    // allocate_aligned, otherwise a composed allocate_aligned would bypass them.
+    template<typename _Allocator>
+    inline block allocate_aligned(_Allocator &allocator, size_t size, size_t blockAlignment)
+    {
+        assert(is_pow2(blockAlignment) && "Alignment must be a power of 2.");
+
+        if (blockAlignment <= _Allocator::alignment)
+        {
+            return allocator.allocate(size);
+        }
+
+        if constexpr (details::has_allocate_aligned<_Allocator>::value)
+        {
+            return allocator.allocate_aligned(size, blockAlignment);
+        }
+        else
+        {
+            return block{ nullptr, 0 };
+        }
+    }
+
+} /*abb*/
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <type_traits>
+
+#include "abb/block.hpp"
+
+
+namespace abb {
+
+    namespace details {
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocator, typename = void>
+        struct has_allocate_n : std::false_type {};
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocator>
+        struct has_allocate_n<_Allocator, std::void_t<decltype(std::declval<_Allocator&>().allocate_n(size_t{}, std::declval<block*>(), size_t{}))>>
+            : std::true_type {};
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocator, typename = void>
+        struct has_deallocate_n : std::false_type {};
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocator>
+        struct has_deallocate_n<_Allocator, std::void_t<decltype(std::declval<_Allocator&>().deallocate_n(std::declval<block*>(), size_t{}))>>
+            : std::true_type {};
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Allocates count blocks of size bytes with as many calls to allocate.
+    // Stops at the first failure and returns how many blocks were allocated.
+    template<typename _Allocator>
+    inline size_t allocate_one_by_one(_Allocator &allocator, size_t size, block *blocks, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            blocks[i] = allocator.allocate(size);
+            if (blocks[i].ptr == nullptr)
+            {
+                return i;
+            }
+        }
+        return count;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    template<typename _Allocator>
+    inline void deallocate_one_by_one(_Allocator &allocator, block *blocks, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            allocator.deallocate(blocks[i]);
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Allocates count blocks of size bytes in blocks, using the allocator's allocate_n if it has
+    // one, one block at a time otherwise.
+    // Stops at the first failure and returns how many blocks were allocated.
+    //
+    // Compositors that inherit from the allocators they compose must define their own allocate_n
+    // and deallocate_n, even as a loop, otherwise a composed allocate_n would bypass them.
+    template<typename _Allocator>
+    inline size_t allocate_n(_Allocator &allocator, size_t size, block *blocks, size_t count)
+    {
+        if constexpr (details::has_allocate_n<_Allocator>::value)
+        {
+            return allocator.allocate_n(size, blocks, count);
+        }
+        else
+        {
+            return allocate_one_by_one(allocator, size, blocks, count);
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Deallocates count blocks, using the allocator's deallocate_n if it has one
+    template<typename _Allocator>
+    inline void deallocate_n(_Allocator &allocator, block *blocks, size_t count)
+    {
+        if constexpr (details::has_deallocate_n<_Allocator>::value)
+        {
+            allocator.deallocate_n(blocks, count);
+        }
+        else
+        {
+            deallocate_one_by_one(allocator, blocks, count);
+        }
+    }
+
+} /*abb*/
@@ -1,6 +1,8 @@
 #pragma once
 
-#include <intrin.h>
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
 
 
 namespace abb {
@@ -33,11 +35,45 @@ namespace abb {
     }
 
     //----------------------------------------------------------------------------------------------
+    // Runtime bit scans, v must not be 0
     inline size_t count_trailing_zeros(size_t v)
     {
+#if defined(_MSC_VER)
         unsigned long bitIndex = 0;
         _BitScanForward64(&bitIndex, v);
         return bitIndex;
+#else
+        return static_cast<size_t>(__builtin_ctzll(v));
+#endif
+    }
+
+    //----------------------------------------------------------------------------------------------
+    inline size_t count_leading_zeros(size_t v)
+    {
+#if defined(_MSC_VER)
+        unsigned long bitIndex = 0;
+        _BitScanReverse64(&bitIndex, v);
+        return 63 - bitIndex;
+#else
+        return static_cast<size_t>(__builtin_clzll(v));
+#endif
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Same result as last_bit_set, but a single bit scan instead of a loop over the bits.
+    // last_bit_set stays the one to use in constant expressions.
+    inline size_t fast_last_bit_set(size_t v)
+    {
+        // The highest bit set doesn't change with the lowest one, except for 0 which gives 0
+        return 63 - count_leading_zeros(v | 1);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Same result as last_bit_set(next_pow2(v)), without branches
+    inline size_t fast_ceil_log2(size_t v)
+    {
+        // last_bit_set(v - 1) + 1 for v > 1, 0 for 1, and next_pow2(0) is 2
+        return fast_last_bit_set((v - 1) & (size_t{ 0 } - (v != 0))) + (v > 1) + (v == 0);
     }
 
 } /*abb*/
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <cstdint>
+
+#include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/units.hpp"
+#include "abb/mallocator.hpp"
+#include "abb/bit_helpers.hpp"
+#include "abb/buffer_provider.hpp"
+#include "abb/reallocation_helpers.hpp"
+
+
+namespace abb {
+
+    //----------------------------------------------------------------------------------------------
+    // A fixed size block allocator that carves _BlockCount blocks of _BlockSize bytes out of a
+    // single buffer and keeps track of the free ones in a bitmap (one bit per block, set if free).
+    // Unlike the linear allocator, any block can be deallocated at any time and be reused.
+    //
+    // The bitmap is made of 64 bits words, and a second, smaller bitmap keeps track of which
+    // words still have at least one free block. Finding a free block is then two bit scans:
+    //
+    // Summary:     |0|1|1|0|...             <- word 1 and 2 have free blocks
+    //                 |
+    //                 v
+    // Words:   |0..0|0..0110|1..1|0..0|...  <- bits set are free blocks
+    //                    ^
+    //           first free block of word 1, found with count_trailing_zeros
+    //
+    template
+    <
+        // The size of each block in bytes, must be a multiple of _Alignment
+          size_t         _BlockSize
+        // How many blocks the buffer holds
+        , size_t         _BlockCount
+        // Alignment of the buffer, hence of every block
+        , size_t         _Alignment
+        // Whether we allocate the buffer on the first allocation or on construction
+        , BufferInitMode _InitMode
+        // The allocator responsible for providing the memory to the buffer provider
+        , typename       _Allocator
+        // The provider of the underlying block of memory
+        , template<size_t, size_t, BufferInitMode, typename> class _BufferProvider
+    >
+    class bitmapped_block
+        : public _BufferProvider<_BlockSize * _BlockCount, _Alignment, _InitMode, _Allocator>
+    {
+        //------------------------------------------------------------------------------------------
+        using buffer_provider_t = _BufferProvider<_BlockSize * _BlockCount, _Alignment, _InitMode, _Allocator>;
+        //------------------------------------------------------------------------------------------
+        using word_t            = uint64_t;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto alignment                       = _Alignment;
+        //------------------------------------------------------------------------------------------
+        static constexpr auto supports_truncated_deallocation = false;
+        //------------------------------------------------------------------------------------------
+        static constexpr auto block_size                      = _BlockSize;
+        //------------------------------------------------------------------------------------------
+        static constexpr auto block_count                     = _BlockCount;
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t bits_per_word     = sizeof(word_t) * 8;
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t num_words         = (_BlockCount + bits_per_word - 1) / bits_per_word;
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t num_summary_words = (num_words + bits_per_word - 1) / bits_per_word;
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Invariants
+        static_assert(!is_dynamic_value(_BlockSize) && !is_dynamic_value(_BlockCount), "bitmapped_block needs a static block size and count.");
+        static_assert(_BlockCount > 0                   , "Pointless bitmapped_block.");
+        static_assert(is_aligned(_BlockSize, _Alignment), "_BlockSize must be a multiple of _Alignment.");
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bitmapped_block()
+        {
+            markAllFree();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Can be moved only if the buffer provider can be moved
+        bitmapped_block(bitmapped_block &&rhs)
+            : buffer_provider_t(std::move(rhs))
+            , firstSummaryWord_(rhs.firstSummaryWord_)
+        {
+            std::copy(std::begin(rhs.freeBits_), std::end(rhs.freeBits_), std::begin(freeBits_));
+            std::copy(std::begin(rhs.freeWords_), std::end(rhs.freeWords_), std::begin(freeWords_));
+            rhs.markAllFree();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Can't be copied
+        bitmapped_block(const bitmapped_block &) = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Allocator interface
+        block allocate(size_t size)
+        {
+            if (size == 0 || size > _BlockSize)
+            {
+                return nullblock;
+            }
+
+            const auto blockIndex = acquireFreeBlock();
+            if (blockIndex == invalid_index)
+            {
+                // Out of memory
+                return nullblock;
+            }
+
+            // Lazy init
+            uint8_t *p = nullptr;
+            buffer_provider_t::init(p);
+
+            // Make sure the memory is backed, free blocks are picked lowest first so the
+            // committed part of the buffer only grows as much as the peak usage
+            const auto pBlock = buffer_provider_t::buffer_ + blockIndex * _BlockSize;
+            if (!buffer_provider_t::commit(pBlock + _BlockSize))
+            {
+                releaseBlock(blockIndex);
+                return nullblock;
+            }
+
+            return block{ pBlock, _BlockSize };
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate(block &b)
+        {
+            if (b.ptr == nullptr)
+            {
+                return;
+            }
+
+            assert(owns(b));
+            const auto blockIndex = static_cast<size_t>(static_cast<uint8_t*>(b.ptr) - begin()) / _BlockSize;
+            releaseBlock(blockIndex);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool reallocate(block &b, size_t newSize)
+        {
+            if (handle_common_reallocation_cases(*this, b, newSize))
+            {
+                return true;
+            }
+
+            // Every block has the same size, any size that fits is already satisfied
+            // and anything bigger can't be handled here
+            return newSize <= _BlockSize;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Every block has the same size
+        static constexpr size_t good_size(size_t size)
+        {
+            return (size != 0 && size <= _BlockSize) ? _BlockSize : size;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool owns(const block &b) const
+        {
+            // If the block falls inside the buffer we own it
+            return (begin() <= b.ptr) && (b.ptr < end());
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Allocator augmented interface
+        void deallocateAll()
+        {
+            markAllFree();
+            buffer_provider_t::decommit();
+        }
+
+    private:
+        // Helpers
+        //------------------------------------------------------------------------------------------
+        inline const uint8_t* begin() const
+        {
+            return buffer_provider_t::buffer_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        inline const uint8_t* end() const
+        {
+            return buffer_provider_t::buffer_ + buffer_provider_t::size();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Finds the first free block, marks it as used and returns its index
+        size_t acquireFreeBlock()
+        {
+            for (auto s = firstSummaryWord_; s < num_summary_words; ++s)
+            {
+                if (freeWords_[s] == 0)
+                {
+                    continue;
+                }
+
+                const auto wordIndex = s * bits_per_word + count_trailing_zeros(freeWords_[s]);
+                const auto bitIndex  = count_trailing_zeros(freeBits_[wordIndex]);
+
+                // Clear the lowest bit set
+                freeBits_[wordIndex] &= freeBits_[wordIndex] - 1;
+                if (freeBits_[wordIndex] == 0)
+                {
+                    // That word is now full
+                    freeWords_[s] &= ~(word_t{ 1 } << (wordIndex % bits_per_word));
+                }
+
+                firstSummaryWord_ = s;
+                return wordIndex * bits_per_word + bitIndex;
+            }
+
+            firstSummaryWord_ = num_summary_words;
+            return invalid_index;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void releaseBlock(size_t blockIndex)
+        {
+            const auto wordIndex    = blockIndex / bits_per_word;
+            const auto summaryIndex = wordIndex / bits_per_word;
+
+            assert((freeBits_[wordIndex] & (word_t{ 1 } << (blockIndex % bits_per_word))) == 0 && "Double free detected.");
+
+            freeBits_[wordIndex]     |= word_t{ 1 } << (blockIndex % bits_per_word);
+            freeWords_[summaryIndex] |= word_t{ 1 } << (wordIndex % bits_per_word);
+            firstSummaryWord_         = std::min(firstSummaryWord_, summaryIndex);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void markAllFree()
+        {
+            for (size_t i = 0; i < num_words; ++i)
+            {
+                const auto bitsInWord = std::min(bits_per_word, _BlockCount - i * bits_per_word);
+                freeBits_[i] = bitsInWord == bits_per_word ? ~word_t{ 0 } : (word_t{ 1 } << bitsInWord) - 1;
+            }
+
+            for (size_t i = 0; i < num_summary_words; ++i)
+            {
+                const auto wordsInSummary = std::min(bits_per_word, num_words - i * bits_per_word);
+                freeWords_[i] = wordsInSummary == bits_per_word ? ~word_t{ 0 } : (word_t{ 1 } << wordsInSummary) - 1;
+            }
+
+            firstSummaryWord_ = 0;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // One bit per block, set if the block is free
+        word_t freeBits_[num_words];
+        // One bit per word of freeBits_, set if the word has at least one free block
+        word_t freeWords_[num_summary_words];
+        // No free block lives before this summary word
+        size_t firstSummaryWord_;
+    };
+
+    //------------------------------------------------------------------------------------------
+    // Shortcut to a bitmapped block using a buffer on the stack
+    template<size_t _BlockSize, size_t _BlockCount, size_t _Alignment = 8_B>
+    using stack_bitmapped_block = bitmapped_block<_BlockSize, _BlockCount, _Alignment, BufferInitMode::InitOnConstruct, void, stack_buffer_provider>;
+
+    //------------------------------------------------------------------------------------------
+    // Shortcut to a bitmapped block using a buffer on the heap
+    template<size_t _BlockSize, size_t _BlockCount, size_t _Alignment = 8_B, BufferInitMode _InitMode = BufferInitMode::InitOnConstruct, typename _Allocator = mallocator>
+    using heap_bitmapped_block = bitmapped_block<_BlockSize, _BlockCount, _Alignment, _InitMode, _Allocator, heap_buffer_provider>;
+
+} /*abb*/
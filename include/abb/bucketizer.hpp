@@ -1,6 +1,9 @@
 #pragma once
 
 #include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
 
 
 namespace abb {
@@ -76,6 +79,24 @@ namespace abb {
             return reallocate_and_copy(buckets_[oldBucketIndex], buckets_[newBucketIndex], b, newSize);
         }
 
+        //------------------------------------------------------------------------------------------
+        // The size of the bucket the size falls in
+        size_t good_size(size_t size) const
+        {
+            return isGoodSize(size)
+                ?  abb::good_size(buckets_[bucketIndex(size)], size)
+                :  size;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The bucket of the size deals with the alignment
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            return isGoodSize(size)
+                ?  abb::allocate_aligned(buckets_[bucketIndex(size)], size, blockAlignment)
+                :  block{ nullptr, 0 };
+        }
+
         //------------------------------------------------------------------------------------------
         bool owns(const block &b) const
         {
@@ -84,6 +105,35 @@ namespace abb {
                 :  false;
         }
 
+    public:
+        //------------------------------------------------------------------------------------------
+        // Batch interface
+        // The bucket is looked up once for the whole batch
+        size_t allocate_n(size_t size, block *blocks, size_t count)
+        {
+            return isGoodSize(size)
+                ?  abb::allocate_n(buckets_[bucketIndex(size)], size, blocks, count)
+                :  0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The bucket is looked up once per run of blocks of the same size
+        void deallocate_n(block *blocks, size_t count)
+        {
+            for (size_t first = 0, last = 0; first < count; first = last)
+            {
+                while (last < count && blocks[last].size == blocks[first].size)
+                {
+                    ++last;
+                }
+
+                if (isGoodSize(blocks[first].size))
+                {
+                    abb::deallocate_n(buckets_[bucketIndex(blocks[first].size)], blocks + first, last - first);
+                }
+            }
+        }
+
     private:
         //------------------------------------------------------------------------------------------
         constexpr bool isGoodSize(size_t size) const
@@ -92,9 +142,9 @@ namespace abb {
         }
 
         //------------------------------------------------------------------------------------------
-        constexpr size_t bucketIndex(size_t size) const
+        size_t bucketIndex(size_t size) const
         {
-            return _RangeRaider::step_index(size);
+            return _RangeRaider::fast_step_index(size);
         }
 
     private:
@@ -0,0 +1,420 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+
+#include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/units.hpp"
+#include "abb/mallocator.hpp"
+#include "abb/bit_helpers.hpp"
+#include "abb/buffer_provider.hpp"
+#include "abb/reallocation_helpers.hpp"
+
+
+namespace abb {
+
+    //----------------------------------------------------------------------------------------------
+    // A buddy allocator carving power of two sized blocks out of a buffer of _MinBlock << _MaxOrder
+    // bytes. A block of order k is _MinBlock << k bytes, and its buddy is the other half of the
+    // block of order k + 1 it was split from.
+    //
+    // Allocating splits the smallest free block big enough until it has the requested order:
+    //          _______________________________________________________________
+    // Order 2 |                                                               |
+    //         |_______________________________________________________________|
+    // Order 1 |              A1               |            free               |
+    //         |_______________|_______________|_______________________________|
+    // Order 0 |      A1       |     free      |
+    //         |_______________|_______________|
+    //
+    // Deallocating merges a block with its buddy for as long as the buddy is free, so free
+    // neighbours always coalesce back. Each order has a free list (written inside the free blocks)
+    // and a bitmap telling which blocks of that order are free, to find the buddy in O(1).
+    //
+    template
+    <
+        // The size of the smallest block, must be a power of 2 big enough to hold two pointers
+          size_t         _MinBlock
+        // The buffer holds one block of order _MaxOrder, i.e. _MinBlock << _MaxOrder bytes
+        , size_t         _MaxOrder
+        // Alignment of the buffer, _MinBlock must be a multiple of it
+        , size_t         _Alignment
+        // Whether we allocate the buffer on the first allocation or on construction
+        , BufferInitMode _InitMode
+        // The allocator responsible for providing the memory to the buffer provider
+        , typename       _Allocator
+        // The provider of the underlying block of memory
+        , template<size_t, size_t, BufferInitMode, typename> class _BufferProvider
+    >
+    class buddy_allocator
+        : public _BufferProvider<(_MinBlock << _MaxOrder), _Alignment, _InitMode, _Allocator>
+    {
+        //------------------------------------------------------------------------------------------
+        using buffer_provider_t = _BufferProvider<(_MinBlock << _MaxOrder), _Alignment, _InitMode, _Allocator>;
+        //------------------------------------------------------------------------------------------
+        using word_t            = uint64_t;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto alignment                       = _Alignment;
+        //------------------------------------------------------------------------------------------
+        static constexpr auto supports_truncated_deallocation = false;
+        //------------------------------------------------------------------------------------------
+        static constexpr auto min_block_size                  = _MinBlock;
+        //------------------------------------------------------------------------------------------
+        static constexpr auto max_block_size                  = _MinBlock << _MaxOrder;
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Free list links, written right inside the free blocks
+        struct node
+        {
+            node *pPrev_;
+            node *pNext_;
+        };
+
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t num_orders        = _MaxOrder + 1;
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t min_block_bit     = last_bit_set(_MinBlock);
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t bits_per_word     = sizeof(word_t) * 8;
+        //------------------------------------------------------------------------------------------
+        // One bit per block of each order: 2^_MaxOrder + ... + 2 + 1
+        static constexpr size_t num_bits          = (size_t{ 2 } << _MaxOrder) - 1;
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t num_words         = (num_bits + bits_per_word - 1) / bits_per_word;
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Invariants
+        static_assert(is_pow2(_MinBlock)                , "_MinBlock must be a power of 2.");
+        static_assert(_MinBlock >= sizeof(node)         , "_MinBlock must be able to hold two pointers.");
+        static_assert(_MaxOrder < bits_per_word - 1     , "_MaxOrder is too big.");
+        static_assert(is_aligned(_MinBlock, _Alignment) , "_MinBlock must be a multiple of _Alignment.");
+
+    public:
+        //------------------------------------------------------------------------------------------
+        buddy_allocator()
+            : isReady_(false)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Can't be moved nor copied, the free lists point inside the buffer
+        buddy_allocator(buddy_allocator &&)         = delete;
+        buddy_allocator(const buddy_allocator &)    = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Allocator interface
+        block allocate(size_t size)
+        {
+            if (size == 0 || size > max_block_size || !ensureReady())
+            {
+                return nullblock;
+            }
+
+            const auto order = orderOf(size);
+
+            // Smallest order with a free block big enough
+            const auto availableOrders = nonEmptyOrders_ >> order;
+            if (availableOrders == 0)
+            {
+                // Out of memory
+                return nullblock;
+            }
+            auto freeOrder = order + count_trailing_zeros(availableOrders);
+
+            auto pBlock = static_cast<uint8_t*>(popFree(freeOrder));
+
+            // Split it until it has the requested order, the upper halves become free
+            while (freeOrder > order)
+            {
+                --freeOrder;
+                pushFree(pBlock + blockSize(freeOrder), freeOrder);
+            }
+
+            return block{ pBlock, blockSize(order) };
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate(block &b)
+        {
+            if (b.ptr == nullptr)
+            {
+                return;
+            }
+
+            assert(owns(b) && is_pow2(b.size) && b.size >= _MinBlock);
+
+            auto order  = orderOf(b.size);
+            auto pBlock = static_cast<uint8_t*>(b.ptr);
+
+            // Merge with the buddy for as long as it is free
+            while (order < _MaxOrder)
+            {
+                const auto pBuddy = buddyOf(pBlock, order);
+                if (!isFree(pBuddy, order))
+                {
+                    break;
+                }
+                removeFree(pBuddy, order);
+                pBlock = std::min(pBlock, pBuddy);
+                ++order;
+            }
+
+            pushFree(pBlock, order);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool reallocate(block &b, size_t newSize)
+        {
+            if (handle_common_reallocation_cases(*this, b, newSize))
+            {
+                return true;
+            }
+
+            if (newSize <= max_block_size && resizeInPlace(b, orderOf(newSize)))
+            {
+                return true;
+            }
+
+            return reallocate_and_copy(*this, *this, b, newSize);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Grows the block over its free buddies
+        bool expand(block &b, size_t delta)
+        {
+            if (delta == 0)
+            {
+                return true;
+            }
+
+            return b.size + delta <= max_block_size && resizeInPlace(b, orderOf(b.size + delta));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Sizes are rounded up to the block of their order
+        size_t good_size(size_t size) const
+        {
+            return (size != 0 && size <= max_block_size) ? blockSize(orderOf(size)) : size;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool owns(const block &b) const
+        {
+            // If the block falls inside the buffer we own it
+            return (begin() <= b.ptr) && (b.ptr < end());
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Allocator augmented interface
+        void deallocateAll()
+        {
+            // The whole buffer becomes one free block again on the next allocation
+            isReady_ = false;
+            buffer_provider_t::decommit();
+        }
+
+    private:
+        // Helpers
+        //------------------------------------------------------------------------------------------
+        inline const uint8_t* begin() const
+        {
+            return buffer_provider_t::buffer_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        inline const uint8_t* end() const
+        {
+            return buffer_provider_t::buffer_ + buffer_provider_t::size();
+        }
+
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t blockSize(size_t order)
+        {
+            return _MinBlock << order;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t orderOf(size_t size)
+        {
+            return size <= _MinBlock ? 0 : fast_ceil_log2(size) - min_block_bit;
+        }
+
+        //------------------------------------------------------------------------------------------
+        size_t offsetOf(const uint8_t *pBlock) const
+        {
+            return static_cast<size_t>(pBlock - begin());
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Computed from the block itself, buffer_ is const in a const member
+        uint8_t* buddyOf(uint8_t *pBlock, size_t order) const
+        {
+            const auto offset = offsetOf(pBlock);
+            return pBlock - offset + (offset ^ blockSize(order));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Index of the block in the free bitmap, orders are laid out one after the other
+        size_t bitIndex(const uint8_t *pBlock, size_t order) const
+        {
+            const auto orderOffset = num_bits + 1 - (size_t{ 2 } << (_MaxOrder - order));
+            return orderOffset + (offsetOf(pBlock) >> (min_block_bit + order));
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool isFree(const uint8_t *pBlock, size_t order) const
+        {
+            const auto i = bitIndex(pBlock, order);
+            return (freeBits_[i / bits_per_word] >> (i % bits_per_word)) & 1;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setFree(const uint8_t *pBlock, size_t order, bool isBlockFree)
+        {
+            const auto i    = bitIndex(pBlock, order);
+            const auto mask = word_t{ 1 } << (i % bits_per_word);
+            freeBits_[i / bits_per_word] = isBlockFree ? (freeBits_[i / bits_per_word] | mask) : (freeBits_[i / bits_per_word] & ~mask);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void pushFree(uint8_t *pBlock, size_t order)
+        {
+            auto pNode = reinterpret_cast<node*>(pBlock);
+            pNode->pPrev_ = nullptr;
+            pNode->pNext_ = freeLists_[order];
+            if (pNode->pNext_)
+            {
+                pNode->pNext_->pPrev_ = pNode;
+            }
+            freeLists_[order] = pNode;
+            nonEmptyOrders_ |= size_t{ 1 } << order;
+            setFree(pBlock, order, true);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void removeFree(uint8_t *pBlock, size_t order)
+        {
+            auto pNode = reinterpret_cast<node*>(pBlock);
+            if (pNode->pPrev_)
+            {
+                pNode->pPrev_->pNext_ = pNode->pNext_;
+            }
+            else
+            {
+                freeLists_[order] = pNode->pNext_;
+            }
+            if (pNode->pNext_)
+            {
+                pNode->pNext_->pPrev_ = pNode->pPrev_;
+            }
+            if (freeLists_[order] == nullptr)
+            {
+                nonEmptyOrders_ &= ~(size_t{ 1 } << order);
+            }
+            setFree(pBlock, order, false);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void* popFree(size_t order)
+        {
+            auto pBlock = reinterpret_cast<uint8_t*>(freeLists_[order]);
+            removeFree(pBlock, order);
+            return pBlock;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Grows the block by absorbing its free buddies, or shrinks it by freeing its upper halves
+        bool resizeInPlace(block &b, size_t newOrder)
+        {
+            const auto pBlock = static_cast<uint8_t*>(b.ptr);
+            const auto order  = orderOf(b.size);
+
+            if (newOrder < order)
+            {
+                // The upper halves can't merge, their buddies are the part we keep
+                for (auto o = order; o > newOrder; --o)
+                {
+                    pushFree(pBlock + blockSize(o - 1), o - 1);
+                }
+                b.size = blockSize(newOrder);
+                return true;
+            }
+
+            // We can only grow if we are the lower half at every order up to the new one
+            if (!is_aligned(offsetOf(pBlock), blockSize(newOrder)))
+            {
+                return false;
+            }
+            for (auto o = order; o < newOrder; ++o)
+            {
+                if (!isFree(pBlock + blockSize(o), o))
+                {
+                    return false;
+                }
+            }
+            for (auto o = order; o < newOrder; ++o)
+            {
+                removeFree(pBlock + blockSize(o), o);
+            }
+            b.size = blockSize(newOrder);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Lazily turns the whole buffer into one free block
+        bool ensureReady()
+        {
+            if (isReady_)
+            {
+                return true;
+            }
+
+            // Lazy init
+            uint8_t *p = nullptr;
+            buffer_provider_t::init(p);
+
+            // The free lists are written everywhere in the buffer, it has to be fully backed
+            if (buffer_provider_t::buffer_ == nullptr || !buffer_provider_t::commit(end()))
+            {
+                return false;
+            }
+
+            std::fill(std::begin(freeBits_), std::end(freeBits_), word_t{ 0 });
+            std::fill(std::begin(freeLists_), std::end(freeLists_), nullptr);
+            nonEmptyOrders_ = 0;
+            pushFree(buffer_provider_t::buffer_, _MaxOrder);
+
+            isReady_ = true;
+            return true;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Free blocks of each order
+        node    *freeLists_[num_orders];
+        // One bit per order, set if its free list isn't empty
+        size_t  nonEmptyOrders_;
+        // One bit per block of each order, set if the block is free
+        word_t  freeBits_[num_words];
+        // Whether the free lists have been set up
+        bool    isReady_;
+    };
+
+    //------------------------------------------------------------------------------------------
+    // Shortcut to a buddy allocator using a buffer on the stack
+    template<size_t _MinBlock, size_t _MaxOrder, size_t _Alignment = 8_B>
+    using stack_buddy_allocator = buddy_allocator<_MinBlock, _MaxOrder, _Alignment, BufferInitMode::InitOnConstruct, void, stack_buffer_provider>;
+
+    //------------------------------------------------------------------------------------------
+    // Shortcut to a buddy allocator using a buffer on the heap
+    template<size_t _MinBlock, size_t _MaxOrder, size_t _Alignment = 8_B, BufferInitMode _InitMode = BufferInitMode::InitOnConstruct, typename _Allocator = mallocator>
+    using heap_buddy_allocator = buddy_allocator<_MinBlock, _MaxOrder, _Alignment, _InitMode, _Allocator, heap_buffer_provider>;
+
+} /*abb*/
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cassert>
+#include <type_traits>
 #include "abb/block.hpp"
 #include "abb/range_helpers.hpp"
 
@@ -21,6 +22,20 @@ namespace abb {
         return initMode == BufferInitMode::InitOnFirstAllocation;
     }
     //----------------------------------------------------------------------------------------------
+    // Opt-in of the allocators which only own the blocks inside their single buffer, and hand out
+    // their first block at its start. Specialized on the exact allocator type: compositors that
+    // derive from such an allocator don't inherit it (e.g. a freelist may own blocks it got from
+    // elsewhere).
+    template<typename _Allocator>
+    struct is_buffer_backed : std::false_type {};
+
+    //----------------------------------------------------------------------------------------------
+    // Besides init and size, every buffer provider exposes:
+    //  - bool commit(const uint8_t *pEnd), called before using the buffer up to pEnd, returns false
+    //    if that memory can't be made available
+    //  - void decommit(), called when the whole buffer is free again
+    // Both do nothing for providers whose memory is usable as soon as the buffer exists.
+    //----------------------------------------------------------------------------------------------
 
     
     //----------------------------------------------------------------------------------------------
@@ -50,8 +65,10 @@ namespace abb {
         stack_buffer_provider(const stack_buffer_provider &)    = delete;
 
         //------------------------------------------------------------------------------------------
-        static constexpr void   init(uint8_t *&ptr) {}
-        static constexpr size_t size()              { return _BufferSize; }
+        static constexpr void   init(uint8_t *&ptr)         {}
+        static constexpr size_t size()                      { return _BufferSize; }
+        static constexpr bool   commit(const uint8_t *)     { return true; }
+        static constexpr void   decommit()                  {}
 
         //------------------------------------------------------------------------------------------
         alignas(_Alignment) uint8_t buffer_[_BufferSize];
@@ -138,6 +155,11 @@ namespace abb {
             return value_type_t::value();
         }
 
+        //------------------------------------------------------------------------------------------
+        // The whole buffer is allocated at once
+        static constexpr bool commit(const uint8_t *)   { return true; }
+        static constexpr void decommit()                {}
+
     protected:
         //------------------------------------------------------------------------------------------
         uint8_t *buffer_;
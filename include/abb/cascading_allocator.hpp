@@ -1,11 +1,28 @@
 #pragma once
 
+#include <functional>
+#include <type_traits>
+
 #include "abb/block.hpp"
+#include "abb/buffer_provider.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/reallocation_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
 
 
 namespace abb {
 
     //----------------------------------------------------------------------------------------------
+    // An allocator that grows a list of _Allocator nodes, each node living inside the memory of
+    // its own allocator. When no node can satisfy a request a new one is prepended to the list.
+    //
+    // To find the node owning a block without walking the whole list, the nodes are also indexed
+    // by address in an intrusive treap. The lookup picks the node with the greatest address below
+    // the block, which is the owner whenever the node is the first thing its allocator hands out
+    // (true for every buffer backed allocator, e.g. linear_allocator). For those (cf.
+    // is_buffer_backed), a candidate that doesn't own the block means that no node does. For the
+    // others, we fall back to walking the list.
+    //
     template<typename _Allocator>
     class cascading_allocator
     {
@@ -25,14 +42,22 @@ namespace abb {
         {
             _Allocator  allocator_;
             node        *pNext_;
+            // Children in the address index
+            node        *pLeft_;
+            node        *pRight_;
 
             node()
                 : pNext_(nullptr)
+                , pLeft_(nullptr)
+                , pRight_(nullptr)
             {}
 
+            // Only nodes that are out of the index are moved, so the index links are not carried over
             node(node &&rhs)
                 : allocator_(std::move(rhs.allocator_))
                 , pNext_(rhs.pNext_)
+                , pLeft_(nullptr)
+                , pRight_(nullptr)
             {
                 rhs.pNext_ = nullptr;
             }
@@ -42,6 +67,7 @@ namespace abb {
         //------------------------------------------------------------------------------------------
         cascading_allocator()
             : pHead_(nullptr)
+            , pRoot_(nullptr)
             , nodeAllocatedSize_(0)
         {}
 
@@ -103,6 +129,35 @@ namespace abb {
             return reallocate_and_copy(pNode->allocator_, *this, b, newSize);
         }
 
+        //------------------------------------------------------------------------------------------
+        bool expand(block &b, size_t delta)
+        {
+            auto pNode = findOwningNode(b);
+            return pNode && abb::expand(pNode->allocator_, b, delta);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Every node has the same kind of allocator
+        size_t good_size(size_t size) const
+        {
+            return pHead_ ? abb::good_size(pHead_->allocator_, size) : size;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Only tries the existing nodes, a new node wouldn't align better than they do
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            for (auto pNode = pHead_; pNode; pNode = pNode->pNext_)
+            {
+                auto b = abb::allocate_aligned(pNode->allocator_, size, blockAlignment);
+                if (b.ptr)
+                {
+                    return b;
+                }
+            }
+            return block{ nullptr, 0 };
+        }
+
         //------------------------------------------------------------------------------------------
         bool owns(const block &b) const
         {
@@ -122,6 +177,9 @@ namespace abb {
             // Erase everything after the head
             eraseNode(pHead_->pNext_);
 
+            // Take the head out of the index, it may not come back at the same address
+            indexErase(pRoot_, pHead_);
+
             // Move the head node on the stack
             node stackNode(std::move(*pHead_));
 
@@ -134,6 +192,7 @@ namespace abb {
 
             // Move back the head inside its allocator
             new (pHead_) node(std::move(stackNode));
+            indexInsert(pRoot_, pHead_);
         }
 
     private:
@@ -170,6 +229,8 @@ namespace abb {
             pNewNode->pNext_ = pHead_;
             // The new node becomes the current head
             pHead_ = pNewNode;
+            // And can be found by address
+            indexInsert(pRoot_, pNewNode);
 
             return pNewNode;
         }
@@ -209,6 +270,8 @@ namespace abb {
             {
                 eraseNode(n->pNext_);
             }
+            // Remove the node from the index before it goes away
+            indexErase(pRoot_, n);
             // Move the node on the stack so it can be properly destructed
             node stackNode(std::move(*n));
             // Recreate a block from the node pointer
@@ -226,12 +289,26 @@ namespace abb {
         }
 
         //------------------------------------------------------------------------------------------
-        node* findOwningNode(const block &b)
+        node* findOwningNode(const block &b) const
         {
+            // Fast path, the closest node below the block is most likely its owner
+            auto pCandidate = findIndexedNode(b.ptr);
+            if (pCandidate && pCandidate->allocator_.owns(b))
+            {
+                return pCandidate;
+            }
+
+            // Each buffer only holds its own node, which sits at its start
+            if constexpr (is_buffer_backed<_Allocator>::value)
+            {
+                return nullptr;
+            }
+
+            // Slow path, ask every other node
             auto pNode = pHead_;
             while (pNode)
             {
-                if (pNode->allocator_.owns(b))
+                if (pNode != pCandidate && pNode->allocator_.owns(b))
                 {
                     return pNode;
                 }
@@ -240,9 +317,132 @@ namespace abb {
             return nullptr;
         }
 
+    private:
+        // Address index
+        //------------------------------------------------------------------------------------------
+        static bool isBefore(const void *lhs, const void *rhs)
+        {
+            return std::less<const void*>()(lhs, rhs);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Treap priority, a hash of the node address so that the tree stays balanced on average
+        static size_t priority(const node *n)
+        {
+            auto h = reinterpret_cast<uintptr_t>(n);
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdull;
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void rotateLeft(node *&n)
+        {
+            auto pRight = n->pRight_;
+            n->pRight_ = pRight->pLeft_;
+            pRight->pLeft_ = n;
+            n = pRight;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void rotateRight(node *&n)
+        {
+            auto pLeft = n->pLeft_;
+            n->pLeft_ = pLeft->pRight_;
+            pLeft->pRight_ = n;
+            n = pLeft;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void indexInsert(node *&root, node *n)
+        {
+            if (root == nullptr)
+            {
+                root = n;
+                return;
+            }
+
+            if (isBefore(n, root))
+            {
+                indexInsert(root->pLeft_, n);
+                if (priority(root->pLeft_) > priority(root))
+                {
+                    rotateRight(root);
+                }
+            }
+            else
+            {
+                indexInsert(root->pRight_, n);
+                if (priority(root->pRight_) > priority(root))
+                {
+                    rotateLeft(root);
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void indexErase(node *&root, node *n)
+        {
+            if (root == nullptr)
+            {
+                return;
+            }
+
+            if (isBefore(n, root))
+            {
+                indexErase(root->pLeft_, n);
+            }
+            else if (isBefore(root, n))
+            {
+                indexErase(root->pRight_, n);
+            }
+            else if (root->pLeft_ == nullptr || root->pRight_ == nullptr)
+            {
+                // At most one child, it takes our place
+                root = root->pLeft_ ? root->pLeft_ : root->pRight_;
+                n->pLeft_  = nullptr;
+                n->pRight_ = nullptr;
+            }
+            else if (priority(root->pLeft_) > priority(root->pRight_))
+            {
+                // Sink the node until it has at most one child
+                rotateRight(root);
+                indexErase(root->pRight_, n);
+            }
+            else
+            {
+                rotateLeft(root);
+                indexErase(root->pLeft_, n);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Returns the node with the greatest address not above ptr
+        node* findIndexedNode(const void *ptr) const
+        {
+            node *pCandidate = nullptr;
+            auto pNode = pRoot_;
+            while (pNode)
+            {
+                if (isBefore(ptr, pNode))
+                {
+                    pNode = pNode->pLeft_;
+                }
+                else
+                {
+                    pCandidate = pNode;
+                    pNode = pNode->pRight_;
+                }
+            }
+            return pCandidate;
+        }
+
     private:
         //------------------------------------------------------------------------------------------
         node    *pHead_;
+        // Root of the address index
+        node    *pRoot_;
         size_t  nodeAllocatedSize_;
     };
 
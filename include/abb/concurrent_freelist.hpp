@@ -0,0 +1,484 @@
+#pragma once
+
+#include <new>
+#include <atomic>
+#include <cstdint>
+
+#include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
+#include "abb/reallocation_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
+
+
+namespace abb {
+
+    //----------------------------------------------------------------------------------------------
+    // Thread safe version of the freelist.
+    //
+    // The list is a lock free (Treiber) stack. To defeat the ABA problem the head packs a
+    // generation counter next to the pointer in a single 64 bits word: x64 pointers only use
+    // their 48 low bits, the 16 high bits are bumped on every successful push or pop.
+    //
+    //  63            48 47                                            0
+    // |  generation    |                  head pointer                 |
+    //
+    // As with any Treiber stack, a pop may read the link of a node that another thread popped in
+    // the meantime, the generation then makes its CAS fail. That memory is guaranteed to still be
+    // readable: the blocks of max_size() bytes that don't fit in the list anymore are only given
+    // back to _Allocator once no pop is in flight. Until then they wait in a retired list, which
+    // the pops and deallocations drain. The read can still race with the new owner of the block
+    // writing it, the value read is then thrown away (thread sanitizers report that race).
+    //
+    // The node count is only approximate while threads race, but it never lets the list hold
+    // more than _MaxNodeCount blocks.
+    //
+    // _Allocator itself must be thread safe since it's called concurrently.
+    //
+    template
+    <
+        // The underlying thread safe allocator which will provide the actual memory blocks
+          typename _Allocator
+        // If the requested allocation size fits inside the inclusive range [_MinSize, _MaxSize]
+        // the freelist will allocate a block of _MaxSize size which could be recycled on deallocation
+        , typename _Range
+        // How many blocks the freelist can hold, if it's full the next block being deallocated
+        // will not be kept in the list
+        , size_t _MaxNodeCount
+        // When allocating a block that fits in the freelist, this parameters enables the allocation of
+        // a bunch on blocks in one step and add them in the freelist
+        , size_t _BatchedAllocations
+    >
+    class concurrent_freelist
+        : public _Allocator
+        , public _Range
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto alignment                       = _Allocator::alignment;
+        //------------------------------------------------------------------------------------------
+        static constexpr auto supports_truncated_deallocation = _Allocator::supports_truncated_deallocation;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        constexpr size_t min_size() const { return _Range::min(); }
+        //------------------------------------------------------------------------------------------
+        constexpr size_t max_size() const { return _Range::max(); }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Constructed right inside freed memory, the link is atomic since it can be read by a
+        // thread while another one pops the node
+        struct node
+        {
+            std::atomic<node*> pNext_{ nullptr };
+        };
+
+        //------------------------------------------------------------------------------------------
+        // Head packing
+        using tagged_ptr_t = uint64_t;
+        static constexpr tagged_ptr_t pointer_bits = 48;
+        static constexpr tagged_ptr_t pointer_mask = (tagged_ptr_t{ 1 } << pointer_bits) - 1;
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Invariants
+        static_assert(sizeof(void*) == sizeof(tagged_ptr_t)    , "The tagged head needs 64 bits pointers.");
+        static_assert(_MaxNodeCount > 0                         , "Pointless freelist.");
+        static_assert(_BatchedAllocations <= _MaxNodeCount      , "Can't allocate more blocks than the _MaxNodeCount.");
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // The list starts empty
+        concurrent_freelist()
+            : head_(0)
+            , pRetired_(nullptr)
+            , activePops_(0)
+            , currentNodeCount_(0)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Can't be moved nor copied, other threads may be using it
+        concurrent_freelist(concurrent_freelist &&)         = delete;
+        concurrent_freelist(const concurrent_freelist &)    = delete;
+
+        //------------------------------------------------------------------------------------------
+        ~concurrent_freelist()
+        {
+            // No other thread can be using the list anymore, properly deallocate every block still in it
+            deallocateChain(pointerOf(head_.load()));
+            deallocateChain(pRetired_.load());
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Allocator interface
+        block allocate(size_t size)
+        {
+            const auto alignedSize = round_to_alignment(size, alignment);
+
+            if (isGoodSize(alignedSize))
+            {
+                // The block fits in the freelist range
+                if (auto ptr = popNode())
+                {
+                    return block{ ptr, max_size() };
+                }
+
+                // The list is empty, preallocate a bunch of blocks (parametrized by _BatchedAllocations)
+                // and keep one for ourselves
+                if (auto ptr = tryPopulateFreeList())
+                {
+                    return block{ ptr, max_size() };
+                }
+            }
+
+            // The size is outside the range, just fall back to the allocator
+            return _Allocator::allocate(alignedSize);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate(block &b)
+        {
+            if (b.size != max_size())
+            {
+                // Never was in the list
+                _Allocator::deallocate(b);
+            }
+            else if (tryReserveNodes(1) == 1)
+            {
+                // The pool still got some space
+                auto pNode = new (b.ptr) node;
+                pushNodes(pNode, pNode);
+            }
+            else
+            {
+                // The pool is full, deallocate the block for real once no pop can read it
+                retire(b);
+                reclaimRetired();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool reallocate(block &b, size_t newSize)
+        {
+            if (handle_common_reallocation_cases(*this, b, newSize))
+            {
+                return true;
+            }
+
+            const auto alignedNewSize = round_to_alignment(newSize, alignment);
+            if (b.size == max_size() && isGoodSize(alignedNewSize))
+            {
+                return true;
+            }
+
+            return reallocate_and_copy(*this, *this, b, newSize);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Sizes in the range get max_size() bytes
+        size_t good_size(size_t size) const
+        {
+            const auto alignedSize = round_to_alignment(size, alignment);
+            return isGoodSize(alignedSize)
+                ? max_size()
+                : abb::good_size(static_cast<const _Allocator&>(*this), alignedSize);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Aligned blocks always come from the allocator, blocks of max_size() bytes join the list
+        // once deallocated
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            if (blockAlignment <= alignment)
+            {
+                return allocate(size);
+            }
+
+            const auto alignedSize = round_to_alignment(size, alignment);
+            return abb::allocate_aligned(static_cast<_Allocator&>(*this), isGoodSize(alignedSize) ? max_size() : alignedSize, blockAlignment);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The blocks of the list already span max_size() bytes, only the others can grow
+        bool expand(block &b, size_t delta)
+        {
+            if (b.size == max_size())
+            {
+                return delta == 0;
+            }
+
+            return abb::expand(static_cast<_Allocator&>(*this), b, delta);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Batch interface
+        // One block at a time, the parent allocator must not be reached without the list
+        size_t allocate_n(size_t size, block *blocks, size_t count)
+        {
+            return allocate_one_by_one(*this, size, blocks, count);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate_n(block *blocks, size_t count)
+        {
+            deallocate_one_by_one(*this, blocks, count);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        void setMinMax(size_t minSize, size_t maxSize)
+        {
+            assert(maxSize >= sizeof(node) && "Maximum allocation size must be at least the size of a pointer.");
+            _Range::setMinMax(minSize, maxSize);
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Helpers
+        constexpr bool isGoodSize(size_t size) const
+        {
+            return min_size() <= size && size <= max_size();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Reserves up to count slots in the list, returns how many were actually reserved
+        size_t tryReserveNodes(size_t count)
+        {
+            const auto previousCount = currentNodeCount_.fetch_add(count, std::memory_order_relaxed);
+            const auto available     = previousCount < _MaxNodeCount ? _MaxNodeCount - previousCount : 0;
+            const auto reserved      = std::min(count, available);
+            if (reserved < count)
+            {
+                currentNodeCount_.fetch_sub(count - reserved, std::memory_order_relaxed);
+            }
+            return reserved;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static node* pointerOf(tagged_ptr_t head)
+        {
+            return reinterpret_cast<node*>(head & pointer_mask);
+        }
+
+        //------------------------------------------------------------------------------------------
+        static tagged_ptr_t nextTag(tagged_ptr_t head, node *pNode)
+        {
+            const auto generation = (head >> pointer_bits) + 1;
+            return (generation << pointer_bits) | reinterpret_cast<tagged_ptr_t>(pNode);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Pushes the chain [pFirst, pLast] in one go, the slots must have been reserved
+        void pushNodes(node *pFirst, node *pLast)
+        {
+            assert(pFirst != nullptr && pLast != nullptr);
+            assert((reinterpret_cast<tagged_ptr_t>(pFirst) & ~pointer_mask) == 0);
+
+            auto head = head_.load(std::memory_order_relaxed);
+            do
+            {
+                // Make the last node of the chain point to the old head
+                pLast->pNext_.store(pointerOf(head), std::memory_order_relaxed);
+            }
+            // The first node of the chain becomes the new head
+            while (!head_.compare_exchange_weak(head, nextTag(head, pFirst), std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The pop is announced before reading the head: a block popped before that can't be read
+        // by this pop, a block popped after it isn't given back to _Allocator until it's done
+        void* popNode()
+        {
+            if (pointerOf(head_.load(std::memory_order_relaxed)) == nullptr)
+            {
+                return nullptr;
+            }
+
+            activePops_.fetch_add(1, std::memory_order_seq_cst);
+            auto head  = head_.load(std::memory_order_seq_cst);
+            auto pHead = pointerOf(head);
+            while (pHead)
+            {
+                // This may read a node that was just popped by another thread, the tag makes the CAS fail then
+                const auto pNext = pHead->pNext_.load(std::memory_order_relaxed);
+                if (head_.compare_exchange_weak(head, nextTag(head, pNext), std::memory_order_seq_cst, std::memory_order_seq_cst))
+                {
+                    break;
+                }
+                pHead = pointerOf(head);
+            }
+            activePops_.fetch_sub(1, std::memory_order_release);
+
+            if (pHead)
+            {
+                currentNodeCount_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            reclaimRetired();
+            return pHead;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // A block popped from the list can't be given back to _Allocator while a pop that may
+        // have read the head before it was popped is in flight
+        void retire(block &b)
+        {
+            if (activePops_.load(std::memory_order_seq_cst) == 0)
+            {
+                _Allocator::deallocate(b);
+                return;
+            }
+
+            auto pNode = new (b.ptr) node;
+            pushRetired(pNode, pNode);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The retired list only gets pushes and is taken whole, it has no ABA problem
+        void pushRetired(node *pFirst, node *pLast)
+        {
+            auto pHead = pRetired_.load(std::memory_order_relaxed);
+            do
+            {
+                pLast->pNext_.store(pHead, std::memory_order_relaxed);
+            }
+            while (!pRetired_.compare_exchange_weak(pHead, pFirst, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Deallocates the retired blocks if no pop is in flight, the pops that start later can't
+        // reach them
+        void reclaimRetired()
+        {
+            if (pRetired_.load(std::memory_order_relaxed) == nullptr)
+            {
+                return;
+            }
+
+            auto pFirst = pRetired_.exchange(nullptr, std::memory_order_acquire);
+            if (pFirst == nullptr)
+            {
+                return;
+            }
+
+            if (activePops_.load(std::memory_order_seq_cst) == 0)
+            {
+                deallocateChain(pFirst);
+                return;
+            }
+
+            // Still read maybe, try again later
+            auto pLast = pFirst;
+            while (auto pNext = pLast->pNext_.load(std::memory_order_relaxed))
+            {
+                pLast = pNext;
+            }
+            pushRetired(pFirst, pLast);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocateChain(node *pNode)
+        {
+            while (pNode)
+            {
+                auto b = block{ pNode, max_size() };
+                pNode = pNode->pNext_.load(std::memory_order_relaxed);
+                _Allocator::deallocate(b);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Allocates a batch of blocks, returns one and pushes the others in the list
+        void* tryPopulateFreeList()
+        {
+            // We allocate blocks of _MaxSize to ensure that any size in the range fits in the freelist blocks
+            const auto blockSize = max_size();
+            // The first block is for the caller, the others need room in the list
+            const auto numBlocks = 1 + tryReserveNodes(_BatchedAllocations > 0 ? _BatchedAllocations - 1 : 0);
+
+            node *pFirst = nullptr;
+            node *pLast  = nullptr;
+            size_t allocatedBlocks = 0;
+
+            // Same optimization as the freelist, cf. freelist::tryPopulateFreeList
+            if (supports_truncated_deallocation)
+            {
+                // Allocate one big block then split it
+                const auto batchBlock = _Allocator::allocate(numBlocks * blockSize);
+                if (batchBlock.ptr != nullptr)
+                {
+                    for (size_t i = 0; i < numBlocks; ++i)
+                    {
+                        chainNode(pFirst, pLast, static_cast<uint8_t*>(batchBlock.ptr) + i * blockSize);
+                    }
+                    allocatedBlocks = numBlocks;
+                }
+            }
+
+            // We either don't support truncated deallocations or the batch allocation failed
+            if (allocatedBlocks == 0)
+            {
+                // Allocate the blocks one by one
+                for (; allocatedBlocks < numBlocks; ++allocatedBlocks)
+                {
+                    auto ptr = _Allocator::allocate(blockSize).ptr;
+                    if (ptr == nullptr)
+                    {
+                        break;
+                    }
+                    chainNode(pFirst, pLast, ptr);
+                }
+            }
+
+            // Give back the slots we reserved but couldn't fill
+            if (allocatedBlocks < numBlocks)
+            {
+                const auto unusedSlots = numBlocks - std::max<size_t>(allocatedBlocks, 1);
+                currentNodeCount_.fetch_sub(unusedSlots, std::memory_order_relaxed);
+            }
+
+            // Out of memory
+            if (pFirst == nullptr)
+            {
+                return nullptr;
+            }
+
+            // Keep the first block, publish the rest
+            if (pFirst != pLast)
+            {
+                pushNodes(pFirst->pNext_.load(std::memory_order_relaxed), pLast);
+            }
+            return pFirst;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Appends a block to a chain that's not yet visible to other threads
+        static void chainNode(node *&pFirst, node *&pLast, void *ptr)
+        {
+            auto pNode = new (ptr) node;
+            if (pLast)
+            {
+                pLast->pNext_.store(pNode, std::memory_order_relaxed);
+            }
+            else
+            {
+                pFirst = pNode;
+            }
+            pLast = pNode;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // The beginning of the freelist with its generation, a null pointer means the list is empty
+        std::atomic<tagged_ptr_t>   head_;
+        // Blocks waiting for the pops in flight before going back to _Allocator
+        std::atomic<node*>          pRetired_;
+        // How many pops may be reading the list
+        std::atomic<size_t>         activePops_;
+        // Approximately how many blocks are currently in the freelist
+        std::atomic<size_t>         currentNodeCount_;
+    };
+
+} /*abb*/
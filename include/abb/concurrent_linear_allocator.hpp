@@ -3,16 +3,45 @@
 #include <atomic>
 
 #include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
 #include "abb/units.hpp"
 #include "abb/mallocator.hpp"
 #include "abb/buffer_provider.hpp"
 
 
 namespace abb {
+
+    //----------------------------------------------------------------------------------------------
+    // How the shared cursor of a concurrent_linear_allocator is moved forward
+    enum class BumpMode
+    {
+        // Retry a compare and swap until it succeeds, the cursor never goes past the end of the buffer
+        CompareExchange,
+        // A single fetch_add, wait free. An allocation that doesn't fit still moves the cursor past
+        // the end, marking the buffer as exhausted, the overshoot is lost until deallocateAll
+        FetchAdd
+    };
     
     //----------------------------------------------------------------------------------------------
     // Thread safe version of the linear allocator
     //
+    // By default every allocation moves the shared cursor with a CAS, which makes the cursor's
+    // cache line bounce between threads under contention. With a non zero _LeaseSize each thread
+    // instead leases a chunk of _LeaseSize bytes from the shared cursor and bump allocates from it
+    // without any synchronization:
+    //          ______________________________________________________
+    // Buffer: |T1 lease.....|T2 lease.....|T1 lease.....|            |
+    //         |XXXXXXX______|XXXX_________|XX___________|____________|
+    //                                                   ^
+    //                                             shared cursor
+    //
+    // Allocations bigger than a lease go straight to the shared cursor. The space left in a lease
+    // that can't fit an allocation is lost until deallocateAll, which also invalidates every lease.
+    // Leases are kept per thread and per allocator type: a thread switching between two instances
+    // of the same type drops its lease each time.
+    //
+    // Both the allocations and the leases take their memory from the shared cursor using _BumpMode.
+    //
     template
     <
         // The size of the block of memory in bytes
@@ -23,6 +52,10 @@ namespace abb {
         , typename       _Allocator
         // The provider of the underlying block of memory
         , template<size_t, size_t, BufferInitMode, typename> class _BufferProvider
+        // Size of the chunks leased by each thread, 0 disables leasing
+        , size_t         _LeaseSize = 0
+        // How the shared cursor is moved
+        , BumpMode       _BumpMode  = BumpMode::CompareExchange
     >
     class concurrent_linear_allocator
         : public _BufferProvider<_BufferSize, _Alignment, BufferInitMode::InitOnConstruct, _Allocator>
@@ -32,21 +65,42 @@ namespace abb {
 
     public:
         //------------------------------------------------------------------------------------------
-        static constexpr auto alignment = _Alignment;
+        static constexpr auto alignment  = _Alignment;
+        //------------------------------------------------------------------------------------------
+        static constexpr auto lease_size = _LeaseSize;
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static_assert(is_aligned(_LeaseSize, _Alignment), "_LeaseSize must be a multiple of _Alignment.");
+
+        //------------------------------------------------------------------------------------------
+        // The chunk of the buffer a thread is currently allocating from
+        struct lease
+        {
+            const concurrent_linear_allocator   *pOwner_        = nullptr;
+            size_t                              generation_     = 0;
+            uint8_t                             *pBegin_        = nullptr;
+            uint8_t                             *p_             = nullptr;
+            uint8_t                             *pEnd_          = nullptr;
+        };
 
     public:
         //------------------------------------------------------------------------------------------
         concurrent_linear_allocator()
             : p_(buffer_provider_t::buffer_)
+            , generation_(nextGeneration())
         {}
 
         //------------------------------------------------------------------------------------------
         // Can be moved only if the buffer provider can be moved
         concurrent_linear_allocator(concurrent_linear_allocator &&rhs)
             : buffer_provider_t(std::move(rhs))
-            , p_(rhs.p_)
+            , p_(rhs.p_.load())
+            , generation_(nextGeneration())
         {
             rhs.p_ = nullptr;
+            // Leases of the moved from allocator now point into our buffer
+            rhs.generation_ = nextGeneration();
         }
 
         //------------------------------------------------------------------------------------------
@@ -59,23 +113,29 @@ namespace abb {
         block allocate(size_t size)
         {
             const auto alignedSize = align(size);
-            auto p = p_.load();
 
-            while (hasEnoughSpace(p, alignedSize))
+            if (is_leasing() && alignedSize <= _LeaseSize)
             {
-                if (p_.compare_exchange_strong(p, p + alignedSize))
-                {
-                    return block { p, alignedSize };
-                }
+                return allocateFromLease(alignedSize);
             }
 
-            // Out of memory
-            return nullblock;
+            return allocateShared(alignedSize);
         }
 
         //------------------------------------------------------------------------------------------
         void deallocate(block &b)
         {
+            // The last block of the thread's lease can be given back to the lease
+            if (is_leasing())
+            {
+                auto &l = currentLease();
+                if (isLastAllocatedBlock(b, l.p_) && b.ptr >= l.pBegin_)
+                {
+                    l.p_ = static_cast<uint8_t*>(b.ptr);
+                    return;
+                }
+            }
+
             // We can only deallocate the last allocated block
             auto p = p_.load();
             while (isLastAllocatedBlock(b, p))
@@ -99,6 +159,17 @@ namespace abb {
             // From here we'll need the aligned size
             const auto alignedNewSize = align(newSize);
 
+            // The last block of the thread's lease can grow or shrink within the lease
+            if (is_leasing())
+            {
+                auto &l = currentLease();
+                if (isLastAllocatedBlock(b, l.p_) && b.ptr >= l.pBegin_ && static_cast<uint8_t*>(b.ptr) + alignedNewSize <= l.pEnd_)
+                {
+                    l.p_ = static_cast<uint8_t*>(b.ptr) + alignedNewSize;
+                    return true;
+                }
+            }
+
             // If we are reallocating the last block on the stack there's room for optimization
             auto p = p_.load();
             while (isLastAllocatedBlock(b, p))
@@ -134,6 +205,13 @@ namespace abb {
             return reallocate_and_copy(*this, *this, b, newSize);
         }
 
+        //------------------------------------------------------------------------------------------
+        // Sizes are rounded up to the alignment
+        static constexpr size_t good_size(size_t size)
+        {
+            return round_to_alignment(size, alignment);
+        }
+
         //------------------------------------------------------------------------------------------
         bool owns(const block &b) const
         {
@@ -147,9 +225,143 @@ namespace abb {
         void deallocateAll()
         {
             p_ = buffer_provider_t::buffer_;
+            // Every lease handed out so far is now stale
+            generation_ = nextGeneration();
+        }
+
+        //------------------------------------------------------------------------------------------
+        static constexpr bool is_leasing()
+        {
+            return _LeaseSize > 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // True once the buffer is full or an allocation failed for lack of space in FetchAdd mode,
+        // until deallocateAll
+        bool exhausted() const
+        {
+            return p_.load(std::memory_order_relaxed) >= end();
         }
 
     private:
+        //------------------------------------------------------------------------------------------
+        // Moves the shared cursor
+        block allocateShared(size_t alignedSize)
+        {
+            if (_BumpMode == BumpMode::FetchAdd)
+            {
+                const auto chunk = fetchAddChunk(alignedSize);
+                return chunk.size >= alignedSize ? block{ chunk.ptr, alignedSize } : nullblock;
+            }
+
+            auto p = p_.load();
+
+            while (hasEnoughSpace(p, alignedSize))
+            {
+                if (p_.compare_exchange_strong(p, p + alignedSize))
+                {
+                    return block { p, alignedSize };
+                }
+            }
+
+            // Out of memory
+            return nullblock;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Moves the shared cursor by size with a single fetch_add, returns what's left of the
+        // requested chunk inside the buffer, which may be smaller than size or empty
+        block fetchAddChunk(size_t size)
+        {
+            // Don't keep pushing the cursor once the buffer is exhausted
+            if (p_.load(std::memory_order_relaxed) >= end())
+            {
+                return nullblock;
+            }
+
+            const auto p = p_.fetch_add(size);
+            if (p >= end())
+            {
+                return nullblock;
+            }
+            return block{ p, std::min<size_t>(size, end() - p) };
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Bump allocates from the thread's lease, leasing a new chunk if needed
+        block allocateFromLease(size_t alignedSize)
+        {
+            auto &l = currentLease();
+
+            if (l.p_ + alignedSize > l.pEnd_)
+            {
+                // Lease a new chunk, the tail of the previous one is lost
+                const auto chunk = leaseChunk(alignedSize);
+                if (!chunk.ptr)
+                {
+                    // Out of memory
+                    return nullblock;
+                }
+                l.pBegin_ = static_cast<uint8_t*>(chunk.ptr);
+                l.p_      = l.pBegin_;
+                l.pEnd_   = l.pBegin_ + chunk.size;
+            }
+
+            block b{ l.p_, alignedSize };
+            l.p_ += alignedSize;
+            return b;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Takes up to _LeaseSize bytes, but at least minSize, from the shared cursor
+        block leaseChunk(size_t minSize)
+        {
+            if (_BumpMode == BumpMode::FetchAdd)
+            {
+                // The last chunk of the buffer may be truncated
+                const auto chunk = fetchAddChunk(_LeaseSize);
+                return chunk.size >= minSize ? chunk : nullblock;
+            }
+
+            auto p = p_.load();
+            while (hasEnoughSpace(p, minSize))
+            {
+                const auto chunkSize = std::min<size_t>(_LeaseSize, end() - p);
+                if (p_.compare_exchange_strong(p, p + chunkSize))
+                {
+                    return block{ p, chunkSize };
+                }
+            }
+            return nullblock;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Returns the calling thread's lease on this allocator, empty if it was invalidated
+        lease& currentLease()
+        {
+            static thread_local lease threadLease;
+
+            const auto generation = generation_.load(std::memory_order_relaxed);
+            if (threadLease.pOwner_ != this || threadLease.generation_ != generation)
+            {
+                threadLease.pOwner_     = this;
+                threadLease.generation_ = generation;
+                threadLease.pBegin_     = nullptr;
+                threadLease.p_          = nullptr;
+                threadLease.pEnd_       = nullptr;
+            }
+            return threadLease;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Generations are unique across instances so that a new allocator living at the address
+        // of a destroyed one can't be mistaken for it
+        static size_t nextGeneration()
+        {
+            static std::atomic<size_t> generation(0);
+            return ++generation;
+        }
+
         // Helpers
         //------------------------------------------------------------------------------------------
         size_t align(size_t size) const
@@ -183,18 +395,20 @@ namespace abb {
 
     private:
         //------------------------------------------------------------------------------------------
-        // A pointer to the top of the stack
-        std::atomic<uint8_t*> p_;
+        // A pointer to the top of the stack, kept on its own cache line
+        alignas(64) std::atomic<uint8_t*> p_;
+        // Bumped every time the leases must be dropped, read on every leased allocation
+        alignas(64) std::atomic<size_t>   generation_;
     };
 
     //------------------------------------------------------------------------------------------
     // Shortcut to a linear allocator using a buffer on the stack
-    template<size_t _BufferSize, size_t _Alignment = 8_B>
-    using concurrent_stack_linear_allocator = concurrent_linear_allocator<_BufferSize, _Alignment, void, stack_buffer_provider>;
+    template<size_t _BufferSize, size_t _Alignment = 8_B, size_t _LeaseSize = 0, BumpMode _BumpMode = BumpMode::CompareExchange>
+    using concurrent_stack_linear_allocator = concurrent_linear_allocator<_BufferSize, _Alignment, void, stack_buffer_provider, _LeaseSize, _BumpMode>;
 
     //------------------------------------------------------------------------------------------
     // Shortcut to a linear allocator using a buffer on the heap
-    template<size_t _BufferSize, size_t _Alignment = 8_B, typename _Allocator = mallocator>
-    using concurrent_heap_linear_allocator = concurrent_linear_allocator<_BufferSize, _Alignment, _Allocator, heap_buffer_provider>;
+    template<size_t _BufferSize, size_t _Alignment = 8_B, typename _Allocator = mallocator, size_t _LeaseSize = 0, BumpMode _BumpMode = BumpMode::CompareExchange>
+    using concurrent_heap_linear_allocator = concurrent_linear_allocator<_BufferSize, _Alignment, _Allocator, heap_buffer_provider, _LeaseSize, _BumpMode>;
     
 } /*abb*/
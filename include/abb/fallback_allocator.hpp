@@ -1,6 +1,10 @@
 #pragma once
 
 #include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
+#include "abb/reallocation_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
 
 
 namespace abb {
@@ -60,12 +64,52 @@ namespace abb {
             return _FallbackAllocator::reallocate(b, newSize);
         }
 
+        //------------------------------------------------------------------------------------------
+        bool expand(block &b, size_t delta)
+        {
+            return _PrimaryAllocator::owns(b)
+                ? abb::expand(static_cast<_PrimaryAllocator&>(*this), b, delta)
+                : abb::expand(static_cast<_FallbackAllocator&>(*this), b, delta);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // What the primary allocator gives, the fallback one is only there when it is out of memory
+        constexpr size_t good_size(size_t size) const
+        {
+            return abb::good_size(static_cast<const _PrimaryAllocator&>(*this), size);
+        }
+
+        //------------------------------------------------------------------------------------------
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            block b = abb::allocate_aligned(static_cast<_PrimaryAllocator&>(*this), size, blockAlignment);
+            if (!b.ptr)
+            {
+                b = abb::allocate_aligned(static_cast<_FallbackAllocator&>(*this), size, blockAlignment);
+            }
+            return b;
+        }
+
         //------------------------------------------------------------------------------------------
         bool owns(const block &b) const
         {
             return _PrimaryAllocator::owns(b) || _FallbackAllocator::owns(b);
         }
 
+        //------------------------------------------------------------------------------------------
+        // Whatever the primary allocator couldn't provide comes from the fallback one
+        size_t allocate_n(size_t size, block *blocks, size_t count)
+        {
+            const auto primaryCount = abb::allocate_n(static_cast<_PrimaryAllocator&>(*this), size, blocks, count);
+            return primaryCount + abb::allocate_n(static_cast<_FallbackAllocator&>(*this), size, blocks + primaryCount, count - primaryCount);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate_n(block *blocks, size_t count)
+        {
+            deallocate_one_by_one(*this, blocks, count);
+        }
+
         //------------------------------------------------------------------------------------------
         void deallocateAll()
         {
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
+#include "abb/reallocation_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
 
 
 namespace abb {
@@ -32,9 +36,9 @@ namespace abb {
 
     public:
         //------------------------------------------------------------------------------------------
-        static constexpr size_t min_size() { return _Range::min(); }
+        constexpr size_t min_size() const { return _Range::min(); }
         //------------------------------------------------------------------------------------------
-        static constexpr size_t max_size() { return _Range::max(); }
+        constexpr size_t max_size() const { return _Range::max(); }
 
     private:
         //------------------------------------------------------------------------------------------
@@ -81,8 +85,8 @@ namespace abb {
             while (pHead_)
             {
                 auto b = block{ pHead_, max_size() };
-                _Allocator::deallocate(b);
                 pHead_ = pHead_->pNext_;
+                _Allocator::deallocate(b);
             }
         }
 
@@ -129,7 +133,7 @@ namespace abb {
         }
 
         //------------------------------------------------------------------------------------------
-        bool reallocate(const block &b, size_t newSize)
+        bool reallocate(block &b, size_t newSize)
         {
             if (handle_common_reallocation_cases(*this, b, newSize))
             {
@@ -137,7 +141,7 @@ namespace abb {
             }
 
             const auto alignedNewSize = round_to_alignment(newSize, alignment);
-            if (isGoodSize(alignedNewSize))
+            if (b.size == max_size() && isGoodSize(alignedNewSize))
             {
                 return true;
             }
@@ -145,6 +149,91 @@ namespace abb {
             return reallocate_and_copy(*this, *this, b, newSize);
         }
 
+        //------------------------------------------------------------------------------------------
+        // Sizes in the range get max_size() bytes
+        size_t good_size(size_t size) const
+        {
+            const auto alignedSize = round_to_alignment(size, alignment);
+            return isGoodSize(alignedSize)
+                ? max_size()
+                : abb::good_size(static_cast<const _Allocator&>(*this), alignedSize);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The head of the list is used if it happens to be aligned, otherwise a block of max_size()
+        // bytes comes aligned from the allocator and joins the list once deallocated
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            if (blockAlignment <= alignment)
+            {
+                return allocate(size);
+            }
+
+            const auto alignedSize = round_to_alignment(size, alignment);
+            if (!isGoodSize(alignedSize))
+            {
+                return abb::allocate_aligned(static_cast<_Allocator&>(*this), alignedSize, blockAlignment);
+            }
+
+            if (pHead_ && is_aligned(reinterpret_cast<uintptr_t>(pHead_), blockAlignment))
+            {
+                return block{ popNode(), max_size() };
+            }
+            return abb::allocate_aligned(static_cast<_Allocator&>(*this), max_size(), blockAlignment);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The blocks of the list already span max_size() bytes, only the others can grow
+        bool expand(block &b, size_t delta)
+        {
+            if (b.size == max_size())
+            {
+                return delta == 0;
+            }
+
+            return abb::expand(static_cast<_Allocator&>(*this), b, delta);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Batch interface
+        // Pops the blocks straight from the list, populating it as many times as needed
+        size_t allocate_n(size_t size, block *blocks, size_t count)
+        {
+            const auto alignedSize = round_to_alignment(size, alignment);
+            if (!isGoodSize(alignedSize))
+            {
+                // The size is outside the range, just fall back to the allocator
+                return abb::allocate_n(static_cast<_Allocator&>(*this), alignedSize, blocks, count);
+            }
+
+            size_t i = 0;
+            while (i < count)
+            {
+                if (!pHead_)
+                {
+                    tryPopulateFreeList();
+                    if (!pHead_)
+                    {
+                        // Let the allocator try the remaining blocks
+                        return i + abb::allocate_n(static_cast<_Allocator&>(*this), max_size(), blocks + i, count - i);
+                    }
+                }
+
+                for (; pHead_ && i < count; ++i)
+                {
+                    blocks[i] = block{ popNode(), max_size() };
+                }
+            }
+            return count;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate_n(block *blocks, size_t count)
+        {
+            deallocate_one_by_one(*this, blocks, count);
+        }
+
     public:
         //------------------------------------------------------------------------------------------
         void setMinMax(size_t minSize, size_t maxSize)
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <new>
+#include <limits>
+#include <cassert>
+#include <cstdint>
+
+#include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/affix_allocator.hpp"
+
+//--------------------------------------------------------------------------------------------------
+// Replaces every form of the global operator new and delete with an abb composition.
+// Include it in exactly one translation unit of the binary, once abb::global_allocator_t names the
+// composition:
+//
+//      namespace abb {
+//          using global_allocator_t = locked_allocator<segregator<1_KiB, bucketizer<...>, mallocator>>;
+//      }
+//      #include "abb/global_new_delete.hpp"
+//
+// The composition is shared by every thread, it must be thread safe (locked_allocator,
+// thread_cache, concurrent_freelist...). It must not use operator new itself, and its blocks must
+// be aligned on __STDCPP_DEFAULT_NEW_ALIGNMENT__ (malloc's blocks are).
+//
+// Every block starts with a header holding its size, for the unsized deletes. Sized deletes don't
+// read it, the size they get routes the block straight through segregators and bucketizers.
+// Over-aligned news pad their block and keep the address of the block right before the pointer
+// they return.
+
+
+namespace abb {
+
+    namespace details {
+
+        //------------------------------------------------------------------------------------------
+        // Keeps the blocks returned by new aligned on the default alignment
+        struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) global_size_header
+        {
+            size_t size;
+        };
+
+        //------------------------------------------------------------------------------------------
+        // Right before the pointers returned by the aligned news
+        struct global_aligned_header
+        {
+            void *pBlock;
+        };
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // The heap behind the global operators, it is never destroyed so that static objects can still
+    // delete memory once main returned
+    template
+    <
+        // The composition to use
+        typename _Allocator
+    >
+    class global_heap
+    {
+        //------------------------------------------------------------------------------------------
+        using affixed_allocator_t = affix_allocator<_Allocator, details::global_size_header>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        static global_heap& instance()
+        {
+            alignas(global_heap) static unsigned char storage[sizeof(global_heap)];
+            static global_heap *pHeap = new (storage) global_heap();
+            return *pHeap;
+        }
+
+        //------------------------------------------------------------------------------------------
+        _Allocator& allocator()
+        {
+            return allocator_;
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // New returns a distinct pointer for each 0 byte request.
+        // The affix_allocator fails the sizes its header would wrap around
+        void* allocate(size_t size)
+        {
+            auto b = allocator_.allocate(size ? size : 1);
+            if (b.ptr == nullptr)
+            {
+                return nullptr;
+            }
+
+            allocator_.prefix(b)->size = b.size;
+            return b.ptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate(void *p)
+        {
+            auto b = block{ p, allocator_.prefix(p)->size };
+            allocator_.deallocate(b);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The size is the one given to new
+        void deallocate(void *p, size_t size)
+        {
+            auto b = block{ p, abb::good_size(allocator_, size ? size : 1) };
+            assert(b.size == allocator_.prefix(p)->size && "Deleted with another size than it was allocated with.");
+            allocator_.deallocate(b);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Pads the block up to the alignment, the padding holds the address of the block
+        void* allocateAligned(size_t size, size_t blockAlignment)
+        {
+            const auto padding = blockAlignment + sizeof(details::global_aligned_header);
+            if (size > std::numeric_limits<size_t>::max() - padding)
+            {
+                return nullptr;
+            }
+
+            auto pBlock = allocate(size + padding);
+            if (pBlock == nullptr)
+            {
+                return nullptr;
+            }
+
+            const auto address = round_to_alignment(reinterpret_cast<uintptr_t>(pBlock) + sizeof(details::global_aligned_header), blockAlignment);
+            reinterpret_cast<details::global_aligned_header*>(address)[-1].pBlock = pBlock;
+            return reinterpret_cast<void*>(address);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocateAligned(void *p)
+        {
+            deallocate(static_cast<details::global_aligned_header*>(p)[-1].pBlock);
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        global_heap() = default;
+
+    private:
+        //------------------------------------------------------------------------------------------
+        affixed_allocator_t allocator_;
+    };
+
+    namespace details {
+
+        //------------------------------------------------------------------------------------------
+        using global_heap_t = global_heap<global_allocator_t>;
+
+        //------------------------------------------------------------------------------------------
+        // Calls the new handler until the allocation succeeds, std::bad_alloc if there's none
+        template<typename _Allocate>
+        inline void* new_or_throw(_Allocate &&allocate)
+        {
+            for (;;)
+            {
+                if (auto p = allocate())
+                {
+                    return p;
+                }
+
+                auto handler = std::get_new_handler();
+                if (handler == nullptr)
+                {
+                    throw std::bad_alloc();
+                }
+                handler();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocate>
+        inline void* new_or_null(_Allocate &&allocate) noexcept
+        {
+            try
+            {
+                return new_or_throw(allocate);
+            }
+            catch (const std::bad_alloc &)
+            {
+                return nullptr;
+            }
+        }
+    }
+
+} /*abb*/
+
+
+//--------------------------------------------------------------------------------------------------
+// The replacements, they can't be inline
+void* operator new(size_t size)
+{
+    return abb::details::new_or_throw([size] { return abb::details::global_heap_t::instance().allocate(size); });
+}
+
+//--------------------------------------------------------------------------------------------------
+void* operator new[](size_t size)
+{
+    return abb::details::new_or_throw([size] { return abb::details::global_heap_t::instance().allocate(size); });
+}
+
+//--------------------------------------------------------------------------------------------------
+void* operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return abb::details::new_or_null([size] { return abb::details::global_heap_t::instance().allocate(size); });
+}
+
+//--------------------------------------------------------------------------------------------------
+void* operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return abb::details::new_or_null([size] { return abb::details::global_heap_t::instance().allocate(size); });
+}
+
+//--------------------------------------------------------------------------------------------------
+void* operator new(size_t size, std::align_val_t blockAlignment)
+{
+    return abb::details::new_or_throw([=] { return abb::details::global_heap_t::instance().allocateAligned(size, static_cast<size_t>(blockAlignment)); });
+}
+
+//--------------------------------------------------------------------------------------------------
+void* operator new[](size_t size, std::align_val_t blockAlignment)
+{
+    return abb::details::new_or_throw([=] { return abb::details::global_heap_t::instance().allocateAligned(size, static_cast<size_t>(blockAlignment)); });
+}
+
+//--------------------------------------------------------------------------------------------------
+void* operator new(size_t size, std::align_val_t blockAlignment, const std::nothrow_t &) noexcept
+{
+    return abb::details::new_or_null([=] { return abb::details::global_heap_t::instance().allocateAligned(size, static_cast<size_t>(blockAlignment)); });
+}
+
+//--------------------------------------------------------------------------------------------------
+void* operator new[](size_t size, std::align_val_t blockAlignment, const std::nothrow_t &) noexcept
+{
+    return abb::details::new_or_null([=] { return abb::details::global_heap_t::instance().allocateAligned(size, static_cast<size_t>(blockAlignment)); });
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete(void *p) noexcept
+{
+    if (p)
+    {
+        abb::details::global_heap_t::instance().deallocate(p);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete[](void *p) noexcept
+{
+    if (p)
+    {
+        abb::details::global_heap_t::instance().deallocate(p);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    if (p)
+    {
+        abb::details::global_heap_t::instance().deallocate(p);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+    if (p)
+    {
+        abb::details::global_heap_t::instance().deallocate(p);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete(void *p, size_t size) noexcept
+{
+    if (p)
+    {
+        abb::details::global_heap_t::instance().deallocate(p, size);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete[](void *p, size_t size) noexcept
+{
+    if (p)
+    {
+        abb::details::global_heap_t::instance().deallocate(p, size);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    if (p)
+    {
+        abb::details::global_heap_t::instance().deallocateAligned(p);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    if (p)
+    {
+        abb::details::global_heap_t::instance().deallocateAligned(p);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{
+    if (p)
+    {
+        abb::details::global_heap_t::instance().deallocateAligned(p);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete[](void *p, size_t, std::align_val_t) noexcept
+{
+    if (p)
+    {
+        abb::details::global_heap_t::instance().deallocateAligned(p);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    if (p)
+    {
+        abb::details::global_heap_t::instance().deallocateAligned(p);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    if (p)
+    {
+        abb::details::global_heap_t::instance().deallocateAligned(p);
+    }
+}
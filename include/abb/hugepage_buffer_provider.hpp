@@ -0,0 +1,250 @@
+#pragma once
+
+#if defined(_WIN32)
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <sys/mman.h>
+#endif
+
+#include <cassert>
+#include "abb/block.hpp"
+#include "abb/units.hpp"
+#include "abb/range_helpers.hpp"
+#include "abb/buffer_provider.hpp"
+
+
+namespace abb {
+
+    //----------------------------------------------------------------------------------------------
+    // What actually backs a hugepage_buffer_provider's buffer
+    enum class PageBacking
+    {
+        // No buffer yet
+        None,
+        // Explicit huge pages (MAP_HUGETLB, MEM_LARGE_PAGES)
+        HugePages,
+        // 2 MiB aligned mapping that the kernel is advised to back with transparent huge pages
+        TransparentHugePages,
+        // Plain pages, huge pages were not available
+        RegularPages
+    };
+
+    //----------------------------------------------------------------------------------------------
+    // Huge pages buffer provider
+    //
+    // Maps the buffer directly from the system, trying to back it with huge pages to cut TLB
+    // misses on big buffers. It first asks for explicit huge pages which need to be reserved
+    // beforehand by the system (vm.nr_hugepages on Linux, the "Lock pages in memory" privilege
+    // on Windows). If that fails, on Linux it maps a 2 MiB aligned range and advises the kernel
+    // to use transparent huge pages, otherwise regular pages are used.
+    // backing() tells which one we got.
+    //
+    template
+    <
+        // The size of the chunk of memory that's going to be mapped, rounded up to huge_page_size
+          size_t         _BufferSize
+        // Alignment of the buffer, the buffer is page aligned which must satisfy it
+        , size_t         _Alignment
+        // Whether we map the memory on creation or on the first allocate
+        , BufferInitMode _InitMode
+        // The memory comes from the system so no need for an allocator
+        , typename
+    >
+    struct hugepage_buffer_provider
+        : public std::conditional
+            <
+                is_dynamic_value(_BufferSize)
+                , dynamic_value_t<size_t>
+                , static_value_t<size_t, _BufferSize>
+            >::type
+    {
+        //------------------------------------------------------------------------------------------
+        using value_type_t = typename std::conditional<is_dynamic_value(_BufferSize), dynamic_value_t<size_t>, static_value_t<size_t, _BufferSize>>::type;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto huge_page_size = 2_MiB;
+
+        //------------------------------------------------------------------------------------------
+        static_assert(_Alignment <= huge_page_size, "Pages can't guarantee an alignment above 2 MiB.");
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Default constructor available for both dynamic and static sizes
+        hugepage_buffer_provider()
+            : buffer_(nullptr)
+            , backing_(PageBacking::None)
+        {
+            if (!is_lazy_init(_InitMode) && !is_dynamic_value(_BufferSize))
+            {
+                buffer_ = map(mappedSize(), backing_);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // This constructor is enabled only if we are dynamically sizing our buffer
+        template<enable_if_workaround_t(is_dynamic_value(_BufferSize))>
+        explicit hugepage_buffer_provider(size_t dynamicBufferSize)
+            : value_type_t(dynamicBufferSize)
+            , buffer_(nullptr)
+            , backing_(PageBacking::None)
+        {
+            if (!is_lazy_init(_InitMode))
+            {
+                buffer_ = map(mappedSize(), backing_);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Can be moved
+        hugepage_buffer_provider(hugepage_buffer_provider &&rhs)
+            : value_type_t(rhs)
+            , buffer_(rhs.buffer_)
+            , backing_(rhs.backing_)
+        {
+            rhs.buffer_  = nullptr;
+            rhs.backing_ = PageBacking::None;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Can't be copied
+        hugepage_buffer_provider(const hugepage_buffer_provider &) = delete;
+
+        //------------------------------------------------------------------------------------------
+        ~hugepage_buffer_provider()
+        {
+            if (buffer_)
+            {
+                unmap(buffer_, mappedSize());
+                buffer_ = nullptr;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void init(uint8_t *&ptr)
+        {
+            if (is_lazy_init(_InitMode) && !buffer_)
+            {
+                assert(value_type_t::is_set());
+                buffer_ = map(mappedSize(), backing_);
+                ptr = buffer_;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        constexpr size_t size() const
+        {
+            return value_type_t::value();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The whole buffer is mapped at once
+        static constexpr bool commit(const uint8_t *)   { return true; }
+        static constexpr void decommit()                {}
+
+        //------------------------------------------------------------------------------------------
+        PageBacking backing() const
+        {
+            return backing_;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        size_t mappedSize() const
+        {
+            return round_to_alignment(size(), huge_page_size);
+        }
+
+        // System calls
+#if defined(_WIN32)
+        //------------------------------------------------------------------------------------------
+        static uint8_t* map(size_t size, PageBacking &backing)
+        {
+            // Large pages must be committed along with the reservation
+            const auto largePageSize = GetLargePageMinimum();
+            if (largePageSize != 0)
+            {
+                if (auto ptr = VirtualAlloc(nullptr, round_to_alignment(size, largePageSize), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE))
+                {
+                    backing = PageBacking::HugePages;
+                    return static_cast<uint8_t*>(ptr);
+                }
+            }
+
+            auto ptr = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            backing = ptr ? PageBacking::RegularPages : PageBacking::None;
+            return static_cast<uint8_t*>(ptr);
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void unmap(uint8_t *ptr, size_t)
+        {
+            VirtualFree(ptr, 0, MEM_RELEASE);
+        }
+#else
+        //------------------------------------------------------------------------------------------
+        static uint8_t* map(size_t size, PageBacking &backing)
+        {
+            constexpr auto protection = PROT_READ | PROT_WRITE;
+            constexpr auto flags      = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#if defined(MAP_HUGETLB)
+            // Explicit huge pages
+            auto ptr = mmap(nullptr, size, protection, flags | MAP_HUGETLB, -1, 0);
+            if (ptr != MAP_FAILED)
+            {
+                backing = PageBacking::HugePages;
+                return static_cast<uint8_t*>(ptr);
+            }
+#endif
+
+            // Map a bit more than needed to be able to align the buffer on a huge page
+            auto rawPtr = mmap(nullptr, size + huge_page_size, protection, flags, -1, 0);
+            if (rawPtr == MAP_FAILED)
+            {
+                backing = PageBacking::None;
+                return nullptr;
+            }
+
+            // Trim what's before and after the aligned range
+            const auto rawBegin     = static_cast<uint8_t*>(rawPtr);
+            const auto alignedBegin = rawBegin + (round_to_alignment(reinterpret_cast<uintptr_t>(rawBegin), huge_page_size) - reinterpret_cast<uintptr_t>(rawBegin));
+            if (alignedBegin != rawBegin)
+            {
+                munmap(rawBegin, alignedBegin - rawBegin);
+            }
+            const auto tailSize = (rawBegin + size + huge_page_size) - (alignedBegin + size);
+            if (tailSize != 0)
+            {
+                munmap(alignedBegin + size, tailSize);
+            }
+
+            backing = PageBacking::RegularPages;
+#if defined(MADV_HUGEPAGE)
+            // Transparent huge pages
+            if (madvise(alignedBegin, size, MADV_HUGEPAGE) == 0)
+            {
+                backing = PageBacking::TransparentHugePages;
+            }
+#endif
+            return alignedBegin;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void unmap(uint8_t *ptr, size_t size)
+        {
+            munmap(ptr, size);
+        }
+#endif
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        uint8_t     *buffer_;
+        // What we got from the system
+        PageBacking backing_;
+    };
+
+} /*abb*/
@@ -1,7 +1,12 @@
 #pragma once
 
 #include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
 #include "abb/buffer_provider.hpp"
+#include "abb/virtual_buffer_provider.hpp"
+#include "abb/hugepage_buffer_provider.hpp"
 
 
 namespace abb {
@@ -115,6 +120,12 @@ namespace abb {
             // Lazy init
             buffer_provider_t::init(p_);
 
+            // Make sure the memory is backed
+            if (!buffer_provider_t::commit(p_ + alignedSize))
+            {
+                return nullblock;
+            }
+
             block b{ p_, alignedSize };
             p_ += alignedSize;
             return b;
@@ -146,7 +157,8 @@ namespace abb {
             if (isLastAllocatedBlock(b))
             {
                 // Check if there's enough memory left
-                if (static_cast<uint8_t*>(b.ptr) + alignedNewSize <= end())
+                if (static_cast<uint8_t*>(b.ptr) + alignedNewSize <= end()
+                    && buffer_provider_t::commit(static_cast<uint8_t*>(b.ptr) + alignedNewSize))
                 {
                     // If so, just update the pointer to the new end of the block
                     // note that it may have shrunk or grown
@@ -172,6 +184,65 @@ namespace abb {
             return reallocate_and_copy(*this, *this, b, newSize);
         }
 
+        //------------------------------------------------------------------------------------------
+        // Only the last allocated block can grow, by moving the cursor
+        bool expand(block &b, size_t delta)
+        {
+            if (delta == 0)
+            {
+                return true;
+            }
+
+            const auto alignedNewSize = align(b.size + delta);
+            const auto pNewEnd        = static_cast<uint8_t*>(b.ptr) + alignedNewSize;
+            if (!isLastAllocatedBlock(b) || pNewEnd > end() || !buffer_provider_t::commit(pNewEnd))
+            {
+                return false;
+            }
+
+            p_ = pNewEnd;
+            b.size = alignedNewSize;
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Sizes are rounded up to the alignment
+        static constexpr size_t good_size(size_t size)
+        {
+            return round_to_alignment(size, alignment);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The cursor is padded up to the alignment, the padding is lost until deallocateAll
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            if (blockAlignment <= alignment)
+            {
+                return allocate(size);
+            }
+
+            // Lazy init
+            buffer_provider_t::init(p_);
+
+            const auto alignedSize  = align(size);
+            const auto padding      = round_to_alignment(reinterpret_cast<uintptr_t>(p_), blockAlignment) - reinterpret_cast<uintptr_t>(p_);
+            if (!hasEnoughSpace(padding + alignedSize))
+            {
+                // Out of memory
+                return nullblock;
+            }
+
+            // Make sure the memory is backed
+            if (!buffer_provider_t::commit(p_ + padding + alignedSize))
+            {
+                return nullblock;
+            }
+
+            block b{ p_ + padding, alignedSize };
+            p_ += padding + alignedSize;
+            return b;
+        }
+
         //------------------------------------------------------------------------------------------
         bool owns(const block &b) const
         {
@@ -179,12 +250,50 @@ namespace abb {
             return (begin() <= b.ptr) && (b.ptr < end()) ;
         }
 
+    public:
+        //------------------------------------------------------------------------------------------
+        // Batch interface
+        // Moves the cursor once for the whole batch, the blocks are contiguous
+        size_t allocate_n(size_t size, block *blocks, size_t count)
+        {
+            // Lazy init
+            buffer_provider_t::init(p_);
+
+            const auto alignedSize = align(size);
+            const auto fitCount    = alignedSize ? std::min(count, static_cast<size_t>(end() - p_) / alignedSize) : count;
+
+            // Make sure the memory is backed
+            if (!buffer_provider_t::commit(p_ + fitCount * alignedSize))
+            {
+                return 0;
+            }
+
+            for (size_t i = 0; i < fitCount; ++i)
+            {
+                blocks[i] = block{ p_, alignedSize };
+                p_ += alignedSize;
+            }
+            return fitCount;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Deallocates from the last block to the first one, so that a batch from allocate_n is
+        // entirely given back
+        void deallocate_n(block *blocks, size_t count)
+        {
+            for (size_t i = count; i > 0; --i)
+            {
+                deallocate(blocks[i - 1]);
+            }
+        }
+
     public:
         //------------------------------------------------------------------------------------------
         // Allocator augmented interface
         void deallocateAll()
         {
             p_ = buffer_provider_t::buffer_;
+            buffer_provider_t::decommit();
         }
 
         //------------------------------------------------------------------------------------------
@@ -237,6 +346,10 @@ namespace abb {
         uint8_t *p_;
     };
 
+    //------------------------------------------------------------------------------------------
+    template<size_t _BufferSize, size_t _Alignment, BufferInitMode _InitMode, typename _Allocator, template<size_t, size_t, BufferInitMode, typename> class _BufferProvider>
+    struct is_buffer_backed<linear_allocator<_BufferSize, _Alignment, _InitMode, _Allocator, _BufferProvider>> : std::true_type {};
+
     //------------------------------------------------------------------------------------------
     // Shortcut to a linear allocator using a buffer on the stack
     template<size_t _BufferSize, size_t _Alignment = 8_B>
@@ -247,4 +360,14 @@ namespace abb {
     template<size_t _BufferSize, size_t _Alignment = 8_B, BufferInitMode _InitMode = BufferInitMode::InitOnConstruct, typename _Allocator = mallocator>
     using heap_linear_allocator = linear_allocator<_BufferSize, _Alignment, _InitMode, _Allocator, heap_buffer_provider>;
 
+    //------------------------------------------------------------------------------------------
+    // Shortcut to a linear allocator reserving address space and committing it as it grows
+    template<size_t _BufferSize, size_t _Alignment = 8_B, BufferInitMode _InitMode = BufferInitMode::InitOnConstruct>
+    using virtual_linear_allocator = linear_allocator<_BufferSize, _Alignment, _InitMode, void, virtual_buffer_provider>;
+
+    //------------------------------------------------------------------------------------------
+    // Shortcut to a linear allocator using a buffer backed by huge pages when possible
+    template<size_t _BufferSize, size_t _Alignment = 8_B, BufferInitMode _InitMode = BufferInitMode::InitOnConstruct>
+    using hugepage_linear_allocator = linear_allocator<_BufferSize, _Alignment, _InitMode, void, hugepage_buffer_provider>;
+
 } /*abb*/
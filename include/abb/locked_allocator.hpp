@@ -0,0 +1,104 @@
+#pragma once
+
+#include <mutex>
+
+#include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
+#include "abb/reallocation_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
+
+
+namespace abb {
+
+    //----------------------------------------------------------------------------------------------
+    // Makes any allocator thread safe by serializing every call behind a mutex.
+    template<typename _Allocator, typename _Mutex = std::mutex>
+    class locked_allocator
+        : public _Allocator
+    {
+        //------------------------------------------------------------------------------------------
+        using lock_t = std::lock_guard<_Mutex>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto alignment = _Allocator::alignment;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        block allocate(size_t size)
+        {
+            lock_t lock(mutex_);
+            return _Allocator::allocate(size);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate(block &b)
+        {
+            lock_t lock(mutex_);
+            _Allocator::deallocate(b);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool reallocate(block &b, size_t newSize)
+        {
+            lock_t lock(mutex_);
+            return _Allocator::reallocate(b, newSize);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool expand(block &b, size_t delta)
+        {
+            lock_t lock(mutex_);
+            return abb::expand(static_cast<_Allocator&>(*this), b, delta);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Doesn't change the state of the allocator, no need to lock
+        size_t good_size(size_t size) const
+        {
+            return abb::good_size(static_cast<const _Allocator&>(*this), size);
+        }
+
+        //------------------------------------------------------------------------------------------
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            lock_t lock(mutex_);
+            return abb::allocate_aligned(static_cast<_Allocator&>(*this), size, blockAlignment);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool owns(const block &b) const
+        {
+            lock_t lock(mutex_);
+            return _Allocator::owns(b);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The lock is taken once for the whole batch
+        size_t allocate_n(size_t size, block *blocks, size_t count)
+        {
+            lock_t lock(mutex_);
+            return abb::allocate_n(static_cast<_Allocator&>(*this), size, blocks, count);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate_n(block *blocks, size_t count)
+        {
+            lock_t lock(mutex_);
+            abb::deallocate_n(static_cast<_Allocator&>(*this), blocks, count);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocateAll()
+        {
+            lock_t lock(mutex_);
+            _Allocator::deallocateAll();
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        mutable _Mutex mutex_;
+    };
+
+} /*abb*/
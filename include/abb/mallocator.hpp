@@ -45,6 +45,30 @@ namespace abb {
             }
             return false;
         }
+
+        //------------------------------------------------------------------------------------------
+        // malloc doesn't tell how much it really gives
+        static constexpr size_t good_size(size_t size)
+        {
+            return size;
+        }
+
+        //------------------------------------------------------------------------------------------
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+#if defined(_WIN32)
+            // Blocks from _aligned_malloc can't be released with free, only malloc's own alignment is available
+            return blockAlignment <= 16_B ? allocate(size) : block{ nullptr, 0 };
+#else
+            // posix_memalign blocks are released with free
+            void *ptr = nullptr;
+            if (posix_memalign(&ptr, blockAlignment < sizeof(void*) ? sizeof(void*) : blockAlignment, size) != 0)
+            {
+                return block{ nullptr, 0 };
+            }
+            return block{ ptr, size };
+#endif
+        }
     };
 
 
@@ -87,6 +111,19 @@ namespace abb {
             }
             return false;
         }
+
+        //------------------------------------------------------------------------------------------
+        // malloc doesn't tell how much it really gives
+        static constexpr size_t good_size(size_t size)
+        {
+            return size;
+        }
+
+        //------------------------------------------------------------------------------------------
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            return block{ _aligned_malloc(size, blockAlignment < _Alignment ? _Alignment : blockAlignment), size };
+        }
     };
 
 } /*abb*/
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <new>
+#include <type_traits>
+#include <memory_resource>
+
+#include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
+
+
+namespace abb {
+
+    namespace details {
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocator, typename = void>
+        struct has_deallocate_all : std::false_type {};
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocator>
+        struct has_deallocate_all<_Allocator, std::void_t<decltype(std::declval<_Allocator&>().deallocateAll())>>
+            : std::true_type {};
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Lets std::pmr containers allocate from an abb composition, which the resource owns.
+    // Alignments above the composition's one go through allocate_aligned, the allocation fails
+    // with std::bad_alloc if the composition can't align that much.
+    // Deallocations rebuild the block from the size pmr passes back, as stl_allocator does.
+    //
+    // Not synchronized, share it between threads only if the composition is thread safe.
+    template
+    <
+        // The allocator to use
+        typename _Allocator
+    >
+    class memory_resource
+        : public std::pmr::memory_resource
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        memory_resource() = default;
+
+        //------------------------------------------------------------------------------------------
+        // Can't be copied
+        memory_resource(const memory_resource &) = delete;
+        memory_resource& operator=(const memory_resource &) = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        _Allocator& allocator()
+        {
+            return allocator_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Gives every block back at once, as monotonic_buffer_resource::release, for compositions
+        // that can (e.g. linear_allocator)
+        void release()
+        {
+            static_assert(details::has_deallocate_all<_Allocator>::value, "The allocator can't deallocate all its blocks at once.");
+            allocator_.deallocateAll();
+        }
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        void* do_allocate(size_t bytes, size_t blockAlignment) override
+        {
+            const auto b = abb::allocate_aligned(allocator_, bytes, blockAlignment);
+            if (b.ptr == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            return b.ptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void do_deallocate(void *p, size_t bytes, size_t) override
+        {
+            auto b = block{ p, abb::good_size(allocator_, bytes) };
+            allocator_.deallocate(b);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Each resource owns its allocator
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        _Allocator allocator_;
+    };
+
+} /*abb*/
@@ -27,6 +27,11 @@ namespace abb {
             return b.ptr == nullptr;
         }
 
+        static constexpr size_t good_size(size_t size)
+        {
+            return size;
+        }
+
         bool owns(const block &b) const
         {
             return b.ptr == nullptr;
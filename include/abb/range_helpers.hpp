@@ -1,6 +1,7 @@
 #pragma once
 
 #include <limits>
+#include <algorithm>
 #include "abb/bit_helpers.hpp"
 
 
@@ -125,6 +126,13 @@ namespace abb {
             return range_t<_Min, _Max>::is_in_range(val) ? (val - _Min) / _Step : invalid_index;
         }
 
+        //------------------------------------------------------------------------------------------
+        // Runtime version of step_index, already free of loops
+        static size_t fast_step_index(size_t val)
+        {
+            return step_index(val);
+        }
+
         //------------------------------------------------------------------------------------------
         static constexpr size_t step_size(size_t)
         {
@@ -148,9 +156,17 @@ namespace abb {
         static constexpr auto num_steps         = pow2bit_max_index - pow2bit_min_index;
 
         //------------------------------------------------------------------------------------------
+        // Steps include their upper bound, _Min belongs to the first one
         static constexpr size_t step_index(size_t val)
         {
-            return last_bit_set(next_pow2(val)) - pow2bit_min_index - 1;
+            return val <= _Min ? 0 : last_bit_set(next_pow2(val)) - pow2bit_min_index - 1;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Runtime version of step_index, bit exact with it but using a single bit scan
+        static size_t fast_step_index(size_t val)
+        {
+            return fast_ceil_log2(std::max(val, _Min + 1)) - pow2bit_min_index - 1;
         }
 
         //------------------------------------------------------------------------------------------
@@ -160,4 +176,59 @@ namespace abb {
         }
     };
 
+    //----------------------------------------------------------------------------------------------
+    // Splits every power of 2 interval of the range in _SubSteps steps of the same size, so that
+    // a size is never rounded up by more than 1 / _SubSteps of its interval (25% for 4 sub steps,
+    // 12.5% for 8) where pow2_range_raider can waste up to 50%:
+    //
+    //   _Min          2 * _Min                      4 * _Min
+    //    |--|--|--|--|-----|-----|-----|-----|...     <- _SubSteps = 4
+    //
+    template<size_t _Min, size_t _Max, size_t _SubSteps>
+    struct geometric_range_raider
+        : public range_t<_Min, _Max>
+    {
+        //------------------------------------------------------------------------------------------
+        static_assert(is_pow2(_Min) && is_pow2(_Max), "_MinSize and _MaxSize must be powers of 2.");
+        //------------------------------------------------------------------------------------------
+        static_assert(is_pow2(_SubSteps) && _SubSteps <= _Min, "_SubSteps must be a power of 2 not bigger than _Min.");
+
+        //------------------------------------------------------------------------------------------
+        static constexpr auto pow2bit_min_index = last_bit_set(_Min);
+        //------------------------------------------------------------------------------------------
+        static constexpr auto pow2bit_max_index = last_bit_set(_Max);
+        //------------------------------------------------------------------------------------------
+        static constexpr auto sub_steps_bits    = last_bit_set(_SubSteps);
+        //------------------------------------------------------------------------------------------
+        static constexpr auto num_steps         = (pow2bit_max_index - pow2bit_min_index) * _SubSteps;
+
+        //------------------------------------------------------------------------------------------
+        // Steps include their upper bound: (val - 1) gives the interval and the sub step inside it
+        static constexpr size_t step_index(size_t val)
+        {
+            return !range_t<_Min, _Max>::is_in_range(val) ? invalid_index
+                :  val == _Min ? 0
+                :  ((last_bit_set(val - 1) - pow2bit_min_index) << sub_steps_bits)
+                 + (((val - 1) >> (last_bit_set(val - 1) - sub_steps_bits)) & (_SubSteps - 1));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Runtime version of step_index, bit exact with it but using a single bit scan
+        static size_t fast_step_index(size_t val)
+        {
+            // _Min belongs to the first step, as _Min + 1 does
+            const auto v   = std::max(val - 1, _Min);
+            const auto bit = fast_last_bit_set(v);
+            return range_t<_Min, _Max>::is_in_range(val)
+                ?  ((bit - pow2bit_min_index) << sub_steps_bits) + ((v >> (bit - sub_steps_bits)) & (_SubSteps - 1))
+                :  invalid_index;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t step_size(size_t stepIndex)
+        {
+            return 1ull << (pow2bit_min_index + (stepIndex >> sub_steps_bits) - sub_steps_bits);
+        }
+    };
+
 } /*abb*/
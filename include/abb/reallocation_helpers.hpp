@@ -1,12 +1,49 @@
 #pragma once
 
 #include <algorithm>
+#include <type_traits>
 
 #include "abb/block.hpp"
 
 
 namespace abb {
 
+    namespace details {
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocator, typename = void>
+        struct has_expand : std::false_type {};
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocator>
+        struct has_expand<_Allocator, std::void_t<decltype(std::declval<_Allocator&>().expand(std::declval<block&>(), size_t{}))>>
+            : std::true_type {};
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Whether the allocator can grow blocks in place
+    template<typename _Allocator>
+    inline constexpr bool supports_expand()
+    {
+        return details::has_expand<_Allocator>::value;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Grows the block by at least delta bytes without moving it, b.size is updated on success.
+    // Allocators without an expand member can't do it, except for a null delta.
+    template<typename _Allocator>
+    inline bool expand(_Allocator &allocator, block &b, size_t delta)
+    {
+        if constexpr (details::has_expand<_Allocator>::value)
+        {
+            return allocator.expand(b, delta);
+        }
+        else
+        {
+            return delta == 0;
+        }
+    }
+
     //----------------------------------------------------------------------------------------------
     template<typename _Allocator>
     inline bool handle_common_reallocation_cases(_Allocator &allocator, block &b, size_t newSize)
@@ -1,12 +1,19 @@
 #pragma once
 
 #include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
 #include "abb/reallocation_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
 
 
 namespace abb {
 
     //----------------------------------------------------------------------------------------------
+    // Sends the requests up to _Threshold bytes to the _SmallAllocator and the bigger ones to the
+    // _LargeAllocator. Blocks are told apart by their size, so the _SmallAllocator must never give
+    // more than _Threshold bytes for a request it gets: its good_size must stay under _Threshold up
+    // to _Threshold (e.g. a power of two _Threshold for a buddy allocator).
     template
     <
         // The segregating parameter in bytes
@@ -29,9 +36,14 @@ namespace abb {
         // Allocator interface
         block allocate(size_t size)
         {
-            return size <= _Threshold
-                ? _SmallAllocator::allocate(size)
-                : _LargeAllocator::allocate(size);
+            if (size <= _Threshold)
+            {
+                const auto b = _SmallAllocator::allocate(size);
+                assert(b.size <= _Threshold && "The small allocator's block is over the threshold.");
+                return b;
+            }
+
+            return _LargeAllocator::allocate(size);
         }
 
         //------------------------------------------------------------------------------------------
@@ -75,6 +87,44 @@ namespace abb {
             return _LargeAllocator::reallocate(b, newSize);
         }
 
+        //------------------------------------------------------------------------------------------
+        // Small blocks can't grow over the threshold, they would be looked for in the large allocator.
+        // The small allocator may grow a block more than asked (e.g. a buddy doubles it), what it
+        // would give for the new size is checked instead.
+        bool expand(block &b, size_t delta)
+        {
+            if (b.size <= _Threshold)
+            {
+                const auto alignedNewSize = round_to_alignment(b.size + delta, _SmallAllocator::alignment);
+                if (abb::good_size(static_cast<const _SmallAllocator&>(*this), alignedNewSize) > _Threshold)
+                {
+                    return false;
+                }
+
+                const bool success = abb::expand(static_cast<_SmallAllocator&>(*this), b, delta);
+                assert(b.size <= _Threshold && "The block grew over the threshold.");
+                return success;
+            }
+
+            return abb::expand(static_cast<_LargeAllocator&>(*this), b, delta);
+        }
+
+        //------------------------------------------------------------------------------------------
+        constexpr size_t good_size(size_t size) const
+        {
+            return size <= _Threshold
+                ? abb::good_size(static_cast<const _SmallAllocator&>(*this), size)
+                : abb::good_size(static_cast<const _LargeAllocator&>(*this), size);
+        }
+
+        //------------------------------------------------------------------------------------------
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            return size <= _Threshold
+                ? abb::allocate_aligned(static_cast<_SmallAllocator&>(*this), size, blockAlignment)
+                : abb::allocate_aligned(static_cast<_LargeAllocator&>(*this), size, blockAlignment);
+        }
+
         //------------------------------------------------------------------------------------------
         bool owns(const block &b) const
         {
@@ -82,6 +132,22 @@ namespace abb {
                 ? _SmallAllocator::owns(b)
                 : _LargeAllocator::owns(b);
         }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Batch interface
+        size_t allocate_n(size_t size, block *blocks, size_t count)
+        {
+            return size <= _Threshold
+                ? abb::allocate_n(static_cast<_SmallAllocator&>(*this), size, blocks, count)
+                : abb::allocate_n(static_cast<_LargeAllocator&>(*this), size, blocks, count);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate_n(block *blocks, size_t count)
+        {
+            deallocate_one_by_one(*this, blocks, count);
+        }
     };
 
 } /*abb*/
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "abb/bit_helpers.hpp"
+#include "abb/stats_collector.hpp"
+
+
+namespace abb {
+
+    namespace details {
+
+        //------------------------------------------------------------------------------------------
+        // Numbers the live threads from 0, the number of a thread is given to the next thread once
+        // it exits, so that live threads always have the smallest numbers
+        class thread_slot
+        {
+        public:
+            //--------------------------------------------------------------------------------------
+            // The number is cached in a constant initialized thread_local, which is read without
+            // the initialization guard the slot itself needs
+            static size_t index()
+            {
+                static thread_local size_t cachedIndex = 0;
+                if (cachedIndex == 0)
+                {
+                    cachedIndex = slotIndex() + 1;
+                }
+                return cachedIndex - 1;
+            }
+
+        private:
+            //--------------------------------------------------------------------------------------
+            static size_t slotIndex()
+            {
+                static thread_local const thread_slot slot;
+                return slot.index_;
+            }
+
+
+            //--------------------------------------------------------------------------------------
+            thread_slot()
+                : index_(acquire())
+            {}
+
+            //--------------------------------------------------------------------------------------
+            ~thread_slot()
+            {
+                std::lock_guard<std::mutex> lock(mutex());
+                freeIndices().push_back(index_);
+            }
+
+            //--------------------------------------------------------------------------------------
+            static size_t acquire()
+            {
+                static size_t nextIndex = 0;
+
+                std::lock_guard<std::mutex> lock(mutex());
+                auto &indices = freeIndices();
+                if (indices.empty())
+                {
+                    return nextIndex++;
+                }
+
+                // Smallest free number first
+                const auto it    = std::min_element(indices.begin(), indices.end());
+                const auto index = *it;
+                indices.erase(it);
+                return index;
+            }
+
+            //--------------------------------------------------------------------------------------
+            static std::mutex& mutex()
+            {
+                static std::mutex m;
+                return m;
+            }
+
+            //--------------------------------------------------------------------------------------
+            static std::vector<size_t>& freeIndices()
+            {
+                static std::vector<size_t> indices;
+                return indices;
+            }
+
+        private:
+            //--------------------------------------------------------------------------------------
+            const size_t index_;
+        };
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Counter with a single writer, updated without atomic read-modify-write so that counting is
+    // as cheap as with a plain integer, and read from any thread for monitoring.
+    // A relaxed load and store are plain moves on x86 and ARM, the only cost over a plain integer
+    // is that the compiler doesn't keep the counter in a register across updates.
+    // Once shared, for when it may have several writers, it is updated with fetch_add instead.
+    class relaxed_counter
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        relaxed_counter() = default;
+
+        //------------------------------------------------------------------------------------------
+        relaxed_counter& operator=(size_t value)
+        {
+            value_.store(value, std::memory_order_relaxed);
+            return *this;
+        }
+
+        //------------------------------------------------------------------------------------------
+        operator size_t() const
+        {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+        //------------------------------------------------------------------------------------------
+        relaxed_counter& operator+=(size_t value)
+        {
+            if (isShared_)
+            {
+                value_.fetch_add(value, std::memory_order_relaxed);
+            }
+            else
+            {
+                value_.store(value_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            }
+            return *this;
+        }
+
+        //------------------------------------------------------------------------------------------
+        relaxed_counter& operator-=(size_t value)
+        {
+            if (isShared_)
+            {
+                value_.fetch_sub(value, std::memory_order_relaxed);
+            }
+            else
+            {
+                value_.store(value_.load(std::memory_order_relaxed) - value, std::memory_order_relaxed);
+            }
+            return *this;
+        }
+
+        //------------------------------------------------------------------------------------------
+        relaxed_counter& operator++()
+        {
+            return *this += 1;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Must be called before any other thread uses the counter
+        void share()
+        {
+            isShared_ = true;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        std::atomic<size_t> value_{ 0 };
+        bool                isShared_{ false };
+    };
+
+    //----------------------------------------------------------------------------------------------
+    // Where a stats_collector keeps its counters when it is shared between threads.
+    // Each live thread updates its own shard, on its own cache lines, so counting neither contends
+    // nor needs atomic read-modify-writes. Reads sum the shards up.
+    // The live threads past the first _ShardCount ones all share one more shard, which they update
+    // with atomic read-modify-writes: nothing is lost, it only gets slower.
+    //
+    // A snapshot is consistent enough for monitoring: each counter is exact once the threads are
+    // quiet, but counters read while they update may be off by the calls in flight.
+    // Blocks can be freed by another thread than the one that allocated them, so the bytes live
+    // of a shard mean nothing on their own. The peak is the highest total seen by snapshots.
+    //
+    // Each call costs a thread_local read to find the shard, then a load and a store per counter
+    // it updates, on cache lines no other thread writes (cf. benchmark_sharded_stats).
+    template
+    <
+        // Number of shards with a single writer
+        size_t _ShardCount = 64
+    >
+    class sharded_stats
+    {
+        //------------------------------------------------------------------------------------------
+        static_assert(_ShardCount > 0, "Pointless sharded_stats.");
+
+        //------------------------------------------------------------------------------------------
+        using shard_stats_t = basic_allocation_stats<relaxed_counter>;
+
+        //------------------------------------------------------------------------------------------
+        struct alignas(64) shard
+        {
+            shard_stats_t stats_;
+        };
+
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr bool tracks_peak = false;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // The last shard is the one the threads past _ShardCount share
+        sharded_stats()
+        {
+            auto &stats = shards_[_ShardCount].stats_;
+            for (auto pCounter : { &stats.allocations, &stats.deallocations, &stats.reallocations, &stats.inPlaceReallocations,
+                                   &stats.ownsCalls, &stats.failures, &stats.bytesLive, &stats.bytesPeak })
+            {
+                pCounter->share();
+            }
+            for (auto &counter : stats.histogram)
+            {
+                counter.share();
+            }
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // The counters the calling thread updates
+        shard_stats_t& local() const
+        {
+            return shards_[std::min(details::thread_slot::index(), _ShardCount)].stats_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        allocation_stats snapshot() const
+        {
+            allocation_stats total;
+            for (const auto &s : shards_)
+            {
+                total.allocations           += s.stats_.allocations;
+                total.deallocations         += s.stats_.deallocations;
+                total.reallocations         += s.stats_.reallocations;
+                total.inPlaceReallocations  += s.stats_.inPlaceReallocations;
+                total.ownsCalls             += s.stats_.ownsCalls;
+                total.failures              += s.stats_.failures;
+                total.bytesLive             += s.stats_.bytesLive;
+                for (size_t i = 0; i < allocation_stats::histogram_size; ++i)
+                {
+                    total.histogram[i] += s.stats_.histogram[i];
+                }
+            }
+
+            // A shard may have seen more frees than allocations, the sum is still right modulo 2^64
+            // unless a free was summed without its allocation, the total is then negative
+            if (total.bytesLive > (std::numeric_limits<size_t>::max() >> 1))
+            {
+                total.bytesLive = 0;
+            }
+
+            auto peak = peak_.load(std::memory_order_relaxed);
+            while (total.bytesLive > peak && !peak_.compare_exchange_weak(peak, total.bytesLive, std::memory_order_relaxed));
+            total.bytesPeak = total.bytesLive > peak ? total.bytesLive : peak;
+            return total;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void reset()
+        {
+            for (auto &s : shards_)
+            {
+                s.stats_.reset();
+            }
+            peak_.store(0, std::memory_order_relaxed);
+            snapshot();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Every block was given back at once
+        void releaseAll()
+        {
+            for (auto &s : shards_)
+            {
+                s.stats_.bytesLive = 0;
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        mutable shard                shards_[_ShardCount + 1];
+        mutable std::atomic<size_t>  peak_{ 0 };
+    };
+
+} /*abb*/
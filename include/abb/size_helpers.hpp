@@ -0,0 +1,47 @@
+#pragma once
+
+#include <type_traits>
+
+#include "abb/block.hpp"
+
+
+namespace abb {
+
+    namespace details {
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocator, typename = void>
+        struct has_good_size : std::false_type {};
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Allocator>
+        struct has_good_size<_Allocator, std::void_t<decltype(std::declval<const _Allocator&>().good_size(size_t{}))>>
+            : std::true_type {};
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // How many bytes a request of size bytes really gets from the allocator, the size itself if
+    // the allocator can't tell
+    template<typename _Allocator>
+    inline constexpr size_t good_size(const _Allocator &allocator, size_t size)
+    {
+        if constexpr (details::has_good_size<_Allocator>::value)
+        {
+            return allocator.good_size(size);
+        }
+        else
+        {
+            return size;
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Allocates at least size bytes and returns a block spanning every byte that came with it, so
+    // that containers can use the whole block as their capacity
+    template<typename _Allocator>
+    inline block allocate_at_least(_Allocator &allocator, size_t size)
+    {
+        return allocator.allocate(good_size(allocator, size));
+    }
+
+} /*abb*/
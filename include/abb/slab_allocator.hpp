@@ -0,0 +1,603 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
+#include "abb/units.hpp"
+#include "abb/bit_helpers.hpp"
+#include "abb/range_helpers.hpp"
+#include "abb/reallocation_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
+
+
+namespace abb {
+
+    //----------------------------------------------------------------------------------------------
+    // A fixed size object allocator that groups objects into slabs of _SlabSize bytes requested
+    // from the parent allocator. Each slab starts with a header holding an occupancy bitmap (one
+    // bit per object, set if free), so any object can be freed at any time and a slab that
+    // becomes empty can be given back to the parent, unlike a freelist which keeps every block.
+    //
+    //         _______________________________________________
+    // Slab:   |header|bitmap|obj|obj|obj|obj|obj|...|obj|    |
+    //         |______|______|___|___|___|___|___|___|___|____|
+    //
+    // Slabs are kept in three lists: partial ones are allocated from first, then empty ones,
+    // and full ones are left alone until one of their objects is freed. Up to _MaxEmptySlabs
+    // empty slabs are kept around so that an allocation pattern oscillating around a slab
+    // boundary doesn't keep allocating and releasing the same slab.
+    //
+    // Slabs must be aligned on _SlabSize so that an object's slab is found by masking its
+    // address: the parent allocator has to guarantee that alignment (e.g. aligned_mallocator).
+    //
+    // The slab addresses are also kept in an open addressing hash set, so that owns() tells in
+    // O(1) whether a block is ours without reading a slab that may not be. The set takes its
+    // storage from the parent allocator as well, by multiples of _SlabSize.
+    //
+    template
+    <
+        // The allocator providing the slabs, its alignment must be at least _SlabSize
+          typename _Allocator
+        // Any size in the inclusive range [_Range::min(), _Range::max()] gets an object of
+        // _Range::max() bytes, can be dynamic so that it can be used in a bucketizer
+        , typename _Range
+        // The size of each slab, must be a power of 2
+        , size_t   _SlabSize
+        // How many empty slabs are kept before giving them back to the parent allocator
+        , size_t   _MaxEmptySlabs
+    >
+    class slab_allocator
+        : public _Allocator
+        , public _Range
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        // Objects are packed on 8 bytes boundaries inside the slabs
+        static constexpr auto alignment                       = 8_B;
+        //------------------------------------------------------------------------------------------
+        static constexpr auto supports_truncated_deallocation = false;
+        //------------------------------------------------------------------------------------------
+        static constexpr auto slab_size                       = _SlabSize;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        constexpr size_t min_size() const { return _Range::min(); }
+        //------------------------------------------------------------------------------------------
+        constexpr size_t max_size() const { return _Range::max(); }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        using word_t = uint64_t;
+
+        //------------------------------------------------------------------------------------------
+        // Written at the beginning of every slab, the bitmap follows it
+        struct slab
+        {
+            // Links in the partial, full or empty list
+            slab            *pPrev_;
+            slab            *pNext_;
+            // How many objects are currently allocated
+            size_t          usedCount_;
+
+            word_t* freeBits() { return reinterpret_cast<word_t*>(this + 1); }
+        };
+
+        //------------------------------------------------------------------------------------------
+        // Doubly linked list of slabs
+        struct slab_list
+        {
+            slab    *pHead_;
+            size_t  count_;
+        };
+
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t bits_per_word = sizeof(word_t) * 8;
+        //------------------------------------------------------------------------------------------
+        // The slab set grows past half full, 0 marks an empty entry
+        static constexpr size_t min_slab_set_capacity = _SlabSize / sizeof(uintptr_t);
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Invariants
+        static_assert(is_pow2(_SlabSize)                    , "_SlabSize must be a power of 2.");
+        static_assert(_Allocator::alignment >= _SlabSize    , "The parent allocator must align slabs on _SlabSize.");
+        static_assert(_SlabSize >= 2 * sizeof(slab)         , "Slabs are too small to hold anything.");
+        static_assert(min_slab_set_capacity >= 2            , "Slabs are too small to hold the slab set.");
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // No slab until the first allocation
+        slab_allocator()
+            : partialSlabs_{ nullptr, 0 }
+            , fullSlabs_{ nullptr, 0 }
+            , emptySlabs_{ nullptr, 0 }
+            , pSlabSet_(nullptr)
+            , slabSetCapacity_(0)
+            , lowestSlab_(UINTPTR_MAX)
+            , highestSlab_(0)
+            , objectSize_(0)
+            , objectsPerSlab_(0)
+            , wordsPerSlab_(0)
+            , firstObjectOffset_(0)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Can't be moved nor copied
+        slab_allocator(slab_allocator &&)       = delete;
+        slab_allocator(const slab_allocator &)  = delete;
+
+        //------------------------------------------------------------------------------------------
+        ~slab_allocator()
+        {
+            deallocateAll();
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Allocator interface
+        block allocate(size_t size)
+        {
+            if (!isGoodSize(size))
+            {
+                return nullblock;
+            }
+
+            // Partial slabs first, then empty ones, then a brand new one
+            auto pSlab = partialSlabs_.pHead_;
+            if (pSlab == nullptr && emptySlabs_.pHead_)
+            {
+                pSlab = emptySlabs_.pHead_;
+                moveSlab(pSlab, emptySlabs_, partialSlabs_);
+            }
+            if (pSlab == nullptr && (pSlab = createSlab()) == nullptr)
+            {
+                // Out of memory
+                return nullblock;
+            }
+
+            const auto objectIndex = acquireObject(pSlab);
+            if (pSlab->usedCount_ == objectsPerSlab_)
+            {
+                moveSlab(pSlab, partialSlabs_, fullSlabs_);
+            }
+
+            return block{ objectAt(pSlab, objectIndex), max_size() };
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate(block &b)
+        {
+            if (b.ptr == nullptr)
+            {
+                return;
+            }
+
+            assert(owns(b));
+            auto pSlab = slabOf(b.ptr);
+            const auto wasFull = pSlab->usedCount_ == objectsPerSlab_;
+            releaseObject(pSlab, objectIndexOf(pSlab, b.ptr));
+
+            if (pSlab->usedCount_ == 0)
+            {
+                moveSlab(pSlab, wasFull ? fullSlabs_ : partialSlabs_, emptySlabs_);
+
+                // Past the hysteresis the slab goes back to the parent allocator
+                if (emptySlabs_.count_ > _MaxEmptySlabs)
+                {
+                    destroySlab(pSlab, emptySlabs_);
+                }
+            }
+            else if (wasFull)
+            {
+                moveSlab(pSlab, fullSlabs_, partialSlabs_);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool reallocate(block &b, size_t newSize)
+        {
+            if (handle_common_reallocation_cases(*this, b, newSize))
+            {
+                return true;
+            }
+
+            // Every object has the same size, any size that fits is already satisfied
+            if (isGoodSize(newSize))
+            {
+                return true;
+            }
+
+            return reallocate_and_copy(*this, *this, b, newSize);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Every object has the same size, they can't grow
+        bool expand(block &, size_t delta)
+        {
+            return delta == 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Every object has the same size
+        size_t good_size(size_t size) const
+        {
+            return isGoodSize(size) ? max_size() : size;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Objects are only aligned on their own size
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            return blockAlignment <= alignment ? allocate(size) : nullblock;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Any block can be asked about, the slab it would belong to is never read
+        bool owns(const block &b) const
+        {
+            if (b.ptr == nullptr || b.size != max_size())
+            {
+                return false;
+            }
+
+            const auto pSlab = slabOf(b.ptr);
+            const auto address = reinterpret_cast<uintptr_t>(pSlab);
+            if (address < lowestSlab_ || address > highestSlab_
+                || static_cast<const uint8_t*>(b.ptr) < reinterpret_cast<const uint8_t*>(pSlab) + firstObjectOffset_)
+            {
+                return false;
+            }
+
+            return containsSlab(address);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Batch interface
+        // One object at a time, slabs are looked up for each of them anyway
+        size_t allocate_n(size_t size, block *blocks, size_t count)
+        {
+            return allocate_one_by_one(*this, size, blocks, count);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate_n(block *blocks, size_t count)
+        {
+            deallocate_one_by_one(*this, blocks, count);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Allocator augmented interface
+        void deallocateAll()
+        {
+            // Every slab goes back to the parent allocator
+            for (auto pList : { &partialSlabs_, &fullSlabs_, &emptySlabs_ })
+            {
+                while (pList->pHead_)
+                {
+                    destroySlab(pList->pHead_, *pList);
+                }
+            }
+
+            if (pSlabSet_)
+            {
+                auto b = block{ pSlabSet_, slabSetCapacity_ * sizeof(uintptr_t) };
+                _Allocator::deallocate(b);
+                pSlabSet_        = nullptr;
+                slabSetCapacity_ = 0;
+            }
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        void setMinMax(size_t minSize, size_t maxSize)
+        {
+            assert(slabCount() == 0 && "Can't change the object size once slabs exist.");
+            _Range::setMinMax(minSize, maxSize);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // How many slabs are currently held, empty ones included
+        size_t slabCount() const
+        {
+            return partialSlabs_.count_ + fullSlabs_.count_ + emptySlabs_.count_;
+        }
+
+    private:
+        // Helpers
+        //------------------------------------------------------------------------------------------
+        constexpr bool isGoodSize(size_t size) const
+        {
+            return min_size() <= size && size <= max_size();
+        }
+
+        //------------------------------------------------------------------------------------------
+        static slab* slabOf(const void *ptr)
+        {
+            return reinterpret_cast<slab*>(reinterpret_cast<uintptr_t>(ptr) & ~(_SlabSize - 1));
+        }
+
+        //------------------------------------------------------------------------------------------
+        void* objectAt(slab *pSlab, size_t objectIndex) const
+        {
+            return reinterpret_cast<uint8_t*>(pSlab) + firstObjectOffset_ + objectIndex * objectSize_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        size_t objectIndexOf(slab *pSlab, const void *ptr) const
+        {
+            return static_cast<size_t>(static_cast<const uint8_t*>(ptr) - reinterpret_cast<uint8_t*>(pSlab) - firstObjectOffset_) / objectSize_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Fits as many objects as possible after the header and their bitmap, done once the
+        // range is known, i.e. on the first slab creation
+        void computeLayout()
+        {
+            objectSize_     = round_to_alignment(max_size(), alignment);
+            objectsPerSlab_ = (_SlabSize - sizeof(slab)) / objectSize_;
+            for (;;)
+            {
+                wordsPerSlab_      = (objectsPerSlab_ + bits_per_word - 1) / bits_per_word;
+                firstObjectOffset_ = round_to_alignment(sizeof(slab) + wordsPerSlab_ * sizeof(word_t), alignment);
+                if (firstObjectOffset_ + objectsPerSlab_ * objectSize_ <= _SlabSize)
+                {
+                    break;
+                }
+                --objectsPerSlab_;
+            }
+            assert(objectsPerSlab_ > 0 && "Objects too big for the slab size.");
+        }
+
+        //------------------------------------------------------------------------------------------
+        slab* createSlab()
+        {
+            if (objectsPerSlab_ == 0)
+            {
+                computeLayout();
+            }
+
+            auto b = _Allocator::allocate(_SlabSize);
+            if (b.ptr == nullptr)
+            {
+                return nullptr;
+            }
+            assert(is_aligned(reinterpret_cast<uintptr_t>(b.ptr), _SlabSize));
+
+            if (!insertSlab(reinterpret_cast<uintptr_t>(b.ptr)))
+            {
+                // No room to remember the slab
+                _Allocator::deallocate(b);
+                return nullptr;
+            }
+
+            auto pSlab = static_cast<slab*>(b.ptr);
+            pSlab->usedCount_ = 0;
+
+            // The range only grows, it just spares owns() the hash of most foreign blocks
+            lowestSlab_  = std::min(lowestSlab_, reinterpret_cast<uintptr_t>(pSlab));
+            highestSlab_ = std::max(highestSlab_, reinterpret_cast<uintptr_t>(pSlab));
+
+            // Every object starts free
+            auto freeBits = pSlab->freeBits();
+            for (size_t i = 0; i < wordsPerSlab_; ++i)
+            {
+                const auto bitsInWord = std::min(bits_per_word, objectsPerSlab_ - i * bits_per_word);
+                freeBits[i] = bitsInWord == bits_per_word ? ~word_t{ 0 } : (word_t{ 1 } << bitsInWord) - 1;
+            }
+
+            pushSlab(pSlab, partialSlabs_);
+            return pSlab;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void destroySlab(slab *pSlab, slab_list &list)
+        {
+            unlinkSlab(pSlab, list);
+            eraseSlab(reinterpret_cast<uintptr_t>(pSlab));
+            auto b = block{ pSlab, _SlabSize };
+            _Allocator::deallocate(b);
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void pushSlab(slab *pSlab, slab_list &list)
+        {
+            pSlab->pPrev_ = nullptr;
+            pSlab->pNext_ = list.pHead_;
+            if (list.pHead_)
+            {
+                list.pHead_->pPrev_ = pSlab;
+            }
+            list.pHead_ = pSlab;
+            ++list.count_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void unlinkSlab(slab *pSlab, slab_list &list)
+        {
+            if (pSlab->pPrev_)
+            {
+                pSlab->pPrev_->pNext_ = pSlab->pNext_;
+            }
+            else
+            {
+                list.pHead_ = pSlab->pNext_;
+            }
+            if (pSlab->pNext_)
+            {
+                pSlab->pNext_->pPrev_ = pSlab->pPrev_;
+            }
+            --list.count_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void moveSlab(slab *pSlab, slab_list &from, slab_list &to)
+        {
+            if (&from != &to)
+            {
+                unlinkSlab(pSlab, from);
+                pushSlab(pSlab, to);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Entry of the slab set where the lookup of a slab address starts
+        size_t slabSetIndexOf(uintptr_t address) const
+        {
+            return static_cast<size_t>(((address / _SlabSize) * 0x9E3779B97F4A7C15ull) >> 32) & (slabSetCapacity_ - 1);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool containsSlab(uintptr_t address) const
+        {
+            if (slabSetCapacity_ == 0)
+            {
+                return false;
+            }
+
+            for (auto i = slabSetIndexOf(address); pSlabSet_[i] != 0; i = (i + 1) & (slabSetCapacity_ - 1))
+            {
+                if (pSlabSet_[i] == address)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Fails if the set has to grow and the parent allocator is out of memory
+        bool insertSlab(uintptr_t address)
+        {
+            if (2 * (slabCount() + 1) > slabSetCapacity_ && !growSlabSet())
+            {
+                return false;
+            }
+
+            auto i = slabSetIndexOf(address);
+            while (pSlabSet_[i] != 0)
+            {
+                i = (i + 1) & (slabSetCapacity_ - 1);
+            }
+            pSlabSet_[i] = address;
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Shifts back the entries that follow so that no lookup stops early on the hole
+        void eraseSlab(uintptr_t address)
+        {
+            const auto mask = slabSetCapacity_ - 1;
+
+            auto hole = slabSetIndexOf(address);
+            while (pSlabSet_[hole] != address)
+            {
+                hole = (hole + 1) & mask;
+            }
+
+            for (auto i = (hole + 1) & mask; pSlabSet_[i] != 0; i = (i + 1) & mask)
+            {
+                // An entry can fill the hole if its lookup starts at or before it
+                const auto start = slabSetIndexOf(pSlabSet_[i]);
+                if (((i - start) & mask) >= ((i - hole) & mask))
+                {
+                    pSlabSet_[hole] = pSlabSet_[i];
+                    hole = i;
+                }
+            }
+            pSlabSet_[hole] = 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Doubles the capacity of the set and rehashes it
+        bool growSlabSet()
+        {
+            const auto newCapacity = std::max(min_slab_set_capacity, 2 * slabSetCapacity_);
+            auto b = _Allocator::allocate(newCapacity * sizeof(uintptr_t));
+            if (b.ptr == nullptr)
+            {
+                return false;
+            }
+            std::memset(b.ptr, 0, newCapacity * sizeof(uintptr_t));
+
+            auto oldSet = block{ pSlabSet_, slabSetCapacity_ * sizeof(uintptr_t) };
+            pSlabSet_        = static_cast<uintptr_t*>(b.ptr);
+            slabSetCapacity_ = newCapacity;
+
+            const auto pOldEntries = static_cast<uintptr_t*>(oldSet.ptr);
+            for (size_t i = 0; i < oldSet.size / sizeof(uintptr_t); ++i)
+            {
+                if (pOldEntries[i] != 0)
+                {
+                    auto j = slabSetIndexOf(pOldEntries[i]);
+                    while (pSlabSet_[j] != 0)
+                    {
+                        j = (j + 1) & (slabSetCapacity_ - 1);
+                    }
+                    pSlabSet_[j] = pOldEntries[i];
+                }
+            }
+
+            if (oldSet.ptr)
+            {
+                _Allocator::deallocate(oldSet);
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Marks the first free object of a non full slab as used and returns its index
+        size_t acquireObject(slab *pSlab)
+        {
+            auto freeBits = pSlab->freeBits();
+            size_t w = 0;
+            while (freeBits[w] == 0)
+            {
+                ++w;
+            }
+
+            const auto bitIndex = count_trailing_zeros(freeBits[w]);
+            // Clear the lowest bit set
+            freeBits[w] &= freeBits[w] - 1;
+            ++pSlab->usedCount_;
+            return w * bits_per_word + bitIndex;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void releaseObject(slab *pSlab, size_t objectIndex)
+        {
+            auto &word = pSlab->freeBits()[objectIndex / bits_per_word];
+            const auto bit = word_t{ 1 } << (objectIndex % bits_per_word);
+
+            assert((word & bit) == 0 && "Double free detected.");
+            word |= bit;
+            --pSlab->usedCount_;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Slabs with both free and used objects
+        slab_list   partialSlabs_;
+        // Slabs without any free object
+        slab_list   fullSlabs_;
+        // Slabs without any used object
+        slab_list   emptySlabs_;
+        // Addresses of the slabs held, slabSetCapacity_ is a power of 2
+        uintptr_t   *pSlabSet_;
+        size_t      slabSetCapacity_;
+        // Address range of every slab ever created
+        uintptr_t   lowestSlab_;
+        uintptr_t   highestSlab_;
+        // Slab layout, computed on the first slab creation
+        size_t      objectSize_;
+        size_t      objectsPerSlab_;
+        size_t      wordsPerSlab_;
+        size_t      firstObjectOffset_;
+    };
+
+} /*abb*/
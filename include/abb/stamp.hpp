@@ -1,6 +1,10 @@
 #pragma once
 
 #include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
+#include "abb/reallocation_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
 
 
 namespace abb {
@@ -40,6 +44,60 @@ namespace abb {
             }
             _Allocator::deallocate(b);
         }
+
+        //------------------------------------------------------------------------------------------
+        size_t good_size(size_t size) const
+        {
+            return abb::good_size(static_cast<const _Allocator&>(*this), size);
+        }
+
+        //------------------------------------------------------------------------------------------
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            block b = abb::allocate_aligned(static_cast<_Allocator&>(*this), size, blockAlignment);
+            if (b.ptr)
+            {
+                memset(b.ptr, _AllocationPattern, b.size);
+            }
+            return b;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The new part of the block is stamped too
+        bool expand(block &b, size_t delta)
+        {
+            const auto oldSize = b.size;
+            if (!abb::expand(static_cast<_Allocator&>(*this), b, delta))
+            {
+                return false;
+            }
+            memset(static_cast<uint8_t*>(b.ptr) + oldSize, _AllocationPattern, b.size - oldSize);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        size_t allocate_n(size_t size, block *blocks, size_t count)
+        {
+            const auto allocated = abb::allocate_n(static_cast<_Allocator&>(*this), size, blocks, count);
+            for (size_t i = 0; i < allocated; ++i)
+            {
+                memset(blocks[i].ptr, _AllocationPattern, blocks[i].size);
+            }
+            return allocated;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate_n(block *blocks, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (blocks[i].ptr)
+                {
+                    memset(blocks[i].ptr, _DeallocationPattern, blocks[i].size);
+                }
+            }
+            abb::deallocate_n(static_cast<_Allocator&>(*this), blocks, count);
+        }
     };
 
 } /*abb*/
@@ -0,0 +1,341 @@
+#pragma once
+
+#include <cstdint>
+
+#include "abb/block.hpp"
+#include "abb/bit_helpers.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
+#include "abb/reallocation_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
+
+
+namespace abb {
+
+    //----------------------------------------------------------------------------------------------
+    // What a stats_collector counts, a counter left out of the flags costs nothing
+    enum StatsFlags : uint32_t
+    {
+        count_allocations   = 1 << 0,
+        count_deallocations = 1 << 1,
+        // Successful in place and copied reallocations, expansions count as in place reallocations
+        count_reallocations = 1 << 2,
+        count_owns          = 1 << 3,
+        // Allocations and reallocations that failed
+        count_failures      = 1 << 4,
+        // Bytes live and their peak
+        track_bytes         = 1 << 5,
+        // Allocations per log2 of their requested size
+        size_histogram      = 1 << 6,
+
+        all_stats           = (1 << 7) - 1,
+    };
+
+    //----------------------------------------------------------------------------------------------
+    template<typename _Counter>
+    struct basic_allocation_stats
+    {
+        //------------------------------------------------------------------------------------------
+        // Bucket i counts the requests of [2^i, 2^(i+1)) bytes, the first one also counts 0
+        static constexpr size_t histogram_size = 64;
+
+        //------------------------------------------------------------------------------------------
+        _Counter allocations{};
+        _Counter deallocations{};
+        _Counter reallocations{};
+        _Counter inPlaceReallocations{};
+        _Counter ownsCalls{};
+        _Counter failures{};
+        _Counter bytesLive{};
+        _Counter bytesPeak{};
+        _Counter histogram[histogram_size]{};
+
+        //------------------------------------------------------------------------------------------
+        size_t copiedReallocations() const
+        {
+            return reallocations - inPlaceReallocations;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Bytes live are kept, they still belong to the allocator
+        void reset()
+        {
+            allocations             = 0;
+            deallocations           = 0;
+            reallocations           = 0;
+            inPlaceReallocations    = 0;
+            ownsCalls               = 0;
+            failures                = 0;
+            bytesPeak               = static_cast<size_t>(bytesLive);
+            for (auto &count : histogram)
+            {
+                count = 0;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        static size_t histogramIndex(size_t size)
+        {
+            return fast_last_bit_set(size);
+        }
+    };
+
+    //----------------------------------------------------------------------------------------------
+    using allocation_stats = basic_allocation_stats<size_t>;
+
+    //----------------------------------------------------------------------------------------------
+    // Where a stats_collector keeps its counters. Plain counters in the allocator itself, for
+    // allocators used by one thread at a time (cf. sharded_stats otherwise).
+    class local_stats
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr bool tracks_peak = true;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // The counters the calling thread updates
+        allocation_stats& local() const
+        {
+            return stats_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        const allocation_stats& snapshot() const
+        {
+            return stats_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void reset()
+        {
+            stats_.reset();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Every block was given back at once
+        void releaseAll()
+        {
+            stats_.bytesLive = 0;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        mutable allocation_stats stats_;
+    };
+
+    //----------------------------------------------------------------------------------------------
+    // Counts what goes through the allocator, to tune compositions (freelist node counts,
+    // segregator thresholds, bucketizer ranges) from real traffic.
+    // local_stats aren't synchronized, put a locked_allocator on top to share the collector between
+    // threads or use sharded_stats.
+    template
+    <
+        // The allocator to observe
+        typename _Allocator,
+        // Combination of StatsFlags
+        uint32_t _Flags = all_stats,
+        // Where the counters are kept (local_stats or sharded_stats)
+        typename _Statistics = local_stats
+    >
+    class stats_collector
+        : public _Allocator
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto alignment = _Allocator::alignment;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        block allocate(size_t size)
+        {
+            block b = _Allocator::allocate(size);
+            onAllocation(size, b, b.ptr != nullptr ? 1 : 0, 1);
+            return b;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate(block &b)
+        {
+            onDeallocation(b, 1);
+            _Allocator::deallocate(b);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool reallocate(block &b, size_t newSize)
+        {
+            const auto oldBlock = b;
+            const bool success  = _Allocator::reallocate(b, newSize);
+            onReallocation(oldBlock, b, success);
+            return success;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool expand(block &b, size_t delta)
+        {
+            const auto oldBlock = b;
+            const bool success  = abb::expand(static_cast<_Allocator&>(*this), b, delta);
+            onReallocation(oldBlock, b, success);
+            return success;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool owns(const block &b) const
+        {
+            if constexpr (has(count_owns))
+            {
+                ++statistics_.local().ownsCalls;
+            }
+            return _Allocator::owns(b);
+        }
+
+        //------------------------------------------------------------------------------------------
+        size_t good_size(size_t size) const
+        {
+            return abb::good_size(static_cast<const _Allocator&>(*this), size);
+        }
+
+        //------------------------------------------------------------------------------------------
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            block b = abb::allocate_aligned(static_cast<_Allocator&>(*this), size, blockAlignment);
+            onAllocation(size, b, b.ptr != nullptr ? 1 : 0, 1);
+            return b;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocateAll()
+        {
+            if constexpr (has(track_bytes))
+            {
+                statistics_.releaseAll();
+            }
+            _Allocator::deallocateAll();
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Batch interface
+        size_t allocate_n(size_t size, block *blocks, size_t count)
+        {
+            const auto allocated = abb::allocate_n(static_cast<_Allocator&>(*this), size, blocks, count);
+            size_t bytes = 0;
+            for (size_t i = 0; i < allocated; ++i)
+            {
+                bytes += blocks[i].size;
+            }
+            onAllocation(size, block{ nullptr, bytes }, allocated, count);
+            return allocated;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate_n(block *blocks, size_t count)
+        {
+            size_t bytes = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                bytes += blocks[i].size;
+            }
+            onDeallocation(block{ nullptr, bytes }, count);
+            abb::deallocate_n(static_cast<_Allocator&>(*this), blocks, count);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        decltype(auto) stats() const
+        {
+            return statistics_.snapshot();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Bytes live are kept, they still belong to the allocator
+        void resetStats()
+        {
+            statistics_.reset();
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr bool has(StatsFlags flag)
+        {
+            return (_Flags & flag) != 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // b spans all the bytes of the allocated blocks
+        void onAllocation(size_t size, const block &b, size_t allocated, size_t requested)
+        {
+            auto &stats = statistics_.local();
+            if constexpr (has(count_allocations))
+            {
+                stats.allocations += allocated;
+            }
+            if constexpr (has(count_failures))
+            {
+                stats.failures += (allocated < requested) ? 1 : 0;
+            }
+            if constexpr (has(size_histogram))
+            {
+                stats.histogram[allocation_stats::histogramIndex(size)] += allocated;
+            }
+            if constexpr (has(track_bytes))
+            {
+                addBytes(stats, b.size);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // b spans all the bytes of the deallocated blocks
+        void onDeallocation(const block &b, size_t count)
+        {
+            auto &stats = statistics_.local();
+            if constexpr (has(count_deallocations))
+            {
+                stats.deallocations += count;
+            }
+            if constexpr (has(track_bytes))
+            {
+                stats.bytesLive -= b.size;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void onReallocation(const block &oldBlock, const block &newBlock, bool success)
+        {
+            auto &stats = statistics_.local();
+            if constexpr (has(count_reallocations))
+            {
+                stats.reallocations        += success ? 1 : 0;
+                stats.inPlaceReallocations += (success && oldBlock.ptr == newBlock.ptr) ? 1 : 0;
+            }
+            if constexpr (has(count_failures))
+            {
+                stats.failures += success ? 0 : 1;
+            }
+            if constexpr (has(track_bytes))
+            {
+                stats.bytesLive -= oldBlock.size;
+                addBytes(stats, newBlock.size);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Stats>
+        static void addBytes(_Stats &stats, size_t size)
+        {
+            stats.bytesLive += size;
+            if constexpr (_Statistics::tracks_peak)
+            {
+                if (stats.bytesLive > stats.bytesPeak)
+                {
+                    stats.bytesPeak = static_cast<size_t>(stats.bytesLive);
+                }
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        _Statistics statistics_;
+    };
+
+} /*abb*/
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <new>
+#include <limits>
+#include <type_traits>
+
+#include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
+
+
+namespace abb {
+
+    namespace details {
+
+        //------------------------------------------------------------------------------------------
+        // One instance per allocator type, whatever the type of the elements
+        template<typename _Allocator>
+        inline _Allocator& shared_instance()
+        {
+            static _Allocator instance;
+            return instance;
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Lets std containers allocate from an abb composition.
+    // Containers give back the number of elements they allocated, the block is rebuilt from it with
+    // the size the allocator would have returned (cf. good_size), so that segregators, bucketizers
+    // and freelists dispatch on the size as usual, without storing it in a header.
+    //
+    // Either refers to an allocator owned elsewhere, which must outlive the containers, or, when
+    // default constructed, to an instance shared by every stl_allocator of the same _Allocator.
+    // Neither is synchronized: share them between threads only if the allocator is thread safe.
+    template
+    <
+        // The type of the elements
+        typename T,
+        // The allocator to use
+        typename _Allocator
+    >
+    class stl_allocator
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using value_type = T;
+
+        //------------------------------------------------------------------------------------------
+        // The allocator follows the memory it allocated
+        using propagate_on_container_copy_assignment    = std::true_type;
+        using propagate_on_container_move_assignment    = std::true_type;
+        using propagate_on_container_swap               = std::true_type;
+        using is_always_equal                           = std::false_type;
+
+        //------------------------------------------------------------------------------------------
+        template<typename U>
+        struct rebind
+        {
+            using other = stl_allocator<U, _Allocator>;
+        };
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Uses the shared instance
+        stl_allocator() noexcept
+            : pAllocator_(&sharedAllocator())
+        {}
+
+        //------------------------------------------------------------------------------------------
+        explicit stl_allocator(_Allocator &allocator) noexcept
+            : pAllocator_(&allocator)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Rebound copies use the same allocator
+        template<typename U>
+        stl_allocator(const stl_allocator<U, _Allocator> &rhs) noexcept
+            : pAllocator_(&rhs.allocator())
+        {}
+
+    public:
+        //------------------------------------------------------------------------------------------
+        T* allocate(size_t n)
+        {
+            if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+            {
+                throw std::bad_array_new_length();
+            }
+
+            const auto b = (alignof(T) > _Allocator::alignment)
+                ? abb::allocate_aligned(*pAllocator_, n * sizeof(T), alignof(T))
+                : pAllocator_->allocate(n * sizeof(T));
+
+            if (b.ptr == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(b.ptr);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate(T *p, size_t n) noexcept
+        {
+            auto b = block{ p, abb::good_size(*pAllocator_, n * sizeof(T)) };
+            pAllocator_->deallocate(b);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        _Allocator& allocator() const noexcept
+        {
+            return *pAllocator_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The instance default constructed stl_allocators use
+        static _Allocator& sharedAllocator()
+        {
+            return details::shared_instance<_Allocator>();
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        _Allocator *pAllocator_;
+    };
+
+    //----------------------------------------------------------------------------------------------
+    // Memory allocated by one can be deallocated by the other
+    template<typename T, typename U, typename _Allocator>
+    inline bool operator==(const stl_allocator<T, _Allocator> &lhs, const stl_allocator<U, _Allocator> &rhs) noexcept
+    {
+        return &lhs.allocator() == &rhs.allocator();
+    }
+
+    //----------------------------------------------------------------------------------------------
+    template<typename T, typename U, typename _Allocator>
+    inline bool operator!=(const stl_allocator<T, _Allocator> &lhs, const stl_allocator<U, _Allocator> &rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+} /*abb*/
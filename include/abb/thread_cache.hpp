@@ -0,0 +1,343 @@
+#pragma once
+
+#include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
+#include "abb/range_helpers.hpp"
+#include "abb/reallocation_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
+
+
+namespace abb {
+
+    //----------------------------------------------------------------------------------------------
+    // A front end that keeps, for each thread, a small freelist per size class in front of a
+    // thread safe shared allocator (e.g. a locked_allocator or a lock free allocator).
+    // Allocations and deallocations that hit the thread's cache don't touch the shared allocator.
+    // An empty freelist is refilled with a batch of blocks, a full one gives half of its blocks
+    // back, and every cached block is given back when the thread exits.
+    //
+    // Size classes are defined by _RangeRaider the same way bucketizer does: class i covers sizes
+    // up to _RangeRaider::min() + step_size(0) + ... + step_size(i), and the cache always asks the
+    // shared allocator for that upper bound so any block of a class can serve any request of it.
+    //
+    // The thread local caches are shared by every instance of the same thread_cache type: when a
+    // thread switches instances its cache is flushed to the previous one first. The thread_cache
+    // must outlive every thread that uses it.
+    //
+    template
+    <
+        // The thread safe allocator that provides the cached blocks
+          typename _SharedAllocator
+        // Splits the cached range into size classes
+        , typename _RangeRaider
+        // How many blocks a thread can keep per size class
+        , size_t   _CacheDepth
+    >
+    class thread_cache
+        : public _SharedAllocator
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto alignment   = _SharedAllocator::alignment;
+        //------------------------------------------------------------------------------------------
+        static constexpr auto num_classes = _RangeRaider::num_steps;
+        //------------------------------------------------------------------------------------------
+        // How many blocks move between the cache and the shared allocator at once
+        static constexpr auto batch_size  = (_CacheDepth + 1) / 2;
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Invariants
+        static_assert(_CacheDepth > 0, "Pointless thread_cache.");
+        static_assert(num_classes > 0, "thread_cache needs at least one size class.");
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Written right inside the cached blocks
+        struct node
+        {
+            node *pNext_;
+        };
+
+        //------------------------------------------------------------------------------------------
+        // What a thread keeps for itself
+        struct local_cache
+        {
+            thread_cache *pOwner_                = nullptr;
+            node         *heads_[num_classes]    = {};
+            size_t       counts_[num_classes]    = {};
+
+            // Thread exit
+            ~local_cache()
+            {
+                if (pOwner_)
+                {
+                    pOwner_->flushAll(*this);
+                }
+            }
+        };
+
+    public:
+        //------------------------------------------------------------------------------------------
+        thread_cache()
+        {
+            assert(raider_.min() >= sizeof(node) && "Cached sizes must be able to hold a pointer.");
+
+            auto classSize = raider_.min();
+            for (size_t i = 0; i < num_classes; ++i)
+            {
+                classSize += _RangeRaider::step_size(i);
+                classSizes_[i] = classSize;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Gives back what the destroying thread cached. Other threads must be done with it.
+        ~thread_cache()
+        {
+            auto &cache = localCache();
+            if (cache.pOwner_ == this)
+            {
+                flushAll(cache);
+                cache.pOwner_ = nullptr;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Can't be copied nor moved, threads may point to it
+        thread_cache(thread_cache &&)       = delete;
+        thread_cache(const thread_cache &)  = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Allocator interface
+        block allocate(size_t size)
+        {
+            const auto classIndex = sizeClass(size);
+            if (classIndex == invalid_index)
+            {
+                return _SharedAllocator::allocate(size);
+            }
+
+            auto &cache = boundCache();
+            if (cache.heads_[classIndex] == nullptr)
+            {
+                refill(cache, classIndex);
+            }
+
+            if (auto ptr = pop(cache, classIndex))
+            {
+                return block{ ptr, classSizes_[classIndex] };
+            }
+
+            // The shared allocator is out of memory
+            return nullblock;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate(block &b)
+        {
+            const auto classIndex = sizeClass(b.size);
+            if (b.ptr == nullptr || classIndex == invalid_index || b.size != classSizes_[classIndex])
+            {
+                _SharedAllocator::deallocate(b);
+                return;
+            }
+
+            auto &cache = boundCache();
+            if (cache.counts_[classIndex] == _CacheDepth)
+            {
+                flush(cache, classIndex, batch_size);
+            }
+            push(cache, classIndex, b.ptr);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool reallocate(block &b, size_t newSize)
+        {
+            if (handle_common_reallocation_cases(*this, b, newSize))
+            {
+                return true;
+            }
+
+            // Staying in the same class, the block is already big enough
+            const auto classIndex = sizeClass(b.size);
+            if (classIndex != invalid_index && b.size == classSizes_[classIndex] && classIndex == sizeClass(newSize))
+            {
+                return true;
+            }
+
+            return reallocate_and_copy(*this, *this, b, newSize);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Cached blocks have the size of their class, only the others can grow
+        bool expand(block &b, size_t delta)
+        {
+            const auto classIndex = sizeClass(b.size);
+            if (classIndex != invalid_index && b.size == classSizes_[classIndex])
+            {
+                return delta == 0;
+            }
+
+            return abb::expand(static_cast<_SharedAllocator&>(*this), b, delta);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Cached sizes get the size of their class
+        size_t good_size(size_t size) const
+        {
+            const auto classIndex = sizeClass(size);
+            return classIndex != invalid_index
+                ? classSizes_[classIndex]
+                : abb::good_size(static_cast<const _SharedAllocator&>(*this), size);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Aligned blocks bypass the caches but keep the size of their class so that they can be
+        // cached once deallocated
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            const auto classIndex = sizeClass(size);
+            return abb::allocate_aligned(static_cast<_SharedAllocator&>(*this), classIndex != invalid_index ? classSizes_[classIndex] : size, blockAlignment);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool owns(const block &b) const
+        {
+            return _SharedAllocator::owns(b);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Batch interface
+        // One block at a time, cache hits are cheap and misses move whole batches anyway
+        size_t allocate_n(size_t size, block *blocks, size_t count)
+        {
+            return allocate_one_by_one(*this, size, blocks, count);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate_n(block *blocks, size_t count)
+        {
+            deallocate_one_by_one(*this, blocks, count);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Gives back every block cached by the calling thread
+        void flush()
+        {
+            auto &cache = localCache();
+            if (cache.pOwner_ == this)
+            {
+                flushAll(cache);
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static local_cache& localCache()
+        {
+            static thread_local local_cache cache;
+            return cache;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Returns the calling thread's cache, making sure it holds blocks of this instance only
+        local_cache& boundCache()
+        {
+            auto &cache = localCache();
+            if (cache.pOwner_ != this)
+            {
+                if (cache.pOwner_)
+                {
+                    cache.pOwner_->flushAll(cache);
+                }
+                cache.pOwner_ = this;
+            }
+            return cache;
+        }
+
+        //------------------------------------------------------------------------------------------
+        size_t sizeClass(size_t size) const
+        {
+            if (size < raider_.min() || size > raider_.max())
+            {
+                return invalid_index;
+            }
+
+            const auto classIndex = _RangeRaider::fast_step_index(size);
+            return (classIndex < num_classes && size <= classSizes_[classIndex])
+                ? classIndex
+                : invalid_index;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The shared allocator is reached once per batch, e.g. a locked_allocator locks once
+        void refill(local_cache &cache, size_t classIndex)
+        {
+            block blocks[batch_size];
+            const auto allocated = abb::allocate_n(static_cast<_SharedAllocator&>(*this), classSizes_[classIndex], blocks, batch_size);
+            for (size_t i = 0; i < allocated; ++i)
+            {
+                push(cache, classIndex, blocks[i].ptr);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void flush(local_cache &cache, size_t classIndex, size_t count)
+        {
+            block blocks[batch_size];
+            while (count > 0 && cache.heads_[classIndex])
+            {
+                size_t popped = 0;
+                for (; popped < std::min(count, batch_size) && cache.heads_[classIndex]; ++popped)
+                {
+                    blocks[popped] = block{ pop(cache, classIndex), classSizes_[classIndex] };
+                }
+                abb::deallocate_n(static_cast<_SharedAllocator&>(*this), blocks, popped);
+                count -= popped;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void flushAll(local_cache &cache)
+        {
+            for (size_t i = 0; i < num_classes; ++i)
+            {
+                flush(cache, i, cache.counts_[i]);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void push(local_cache &cache, size_t classIndex, void *ptr)
+        {
+            auto pNewHead = static_cast<node*>(ptr);
+            pNewHead->pNext_ = cache.heads_[classIndex];
+            cache.heads_[classIndex] = pNewHead;
+            ++cache.counts_[classIndex];
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void* pop(local_cache &cache, size_t classIndex)
+        {
+            auto pHead = cache.heads_[classIndex];
+            if (pHead)
+            {
+                cache.heads_[classIndex] = pHead->pNext_;
+                --cache.counts_[classIndex];
+            }
+            return pHead;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Not a base class since the shared allocator is likely a bucketizer using the same raider
+        _RangeRaider raider_;
+        // Size of the blocks handed out by each class
+        size_t       classSizes_[num_classes];
+    };
+
+} /*abb*/
@@ -0,0 +1,476 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+
+#include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/units.hpp"
+#include "abb/mallocator.hpp"
+#include "abb/bit_helpers.hpp"
+#include "abb/buffer_provider.hpp"
+#include "abb/reallocation_helpers.hpp"
+
+
+namespace abb {
+
+    //----------------------------------------------------------------------------------------------
+    // Two Level Segregated Fit allocator: allocates blocks of any size inside one buffer with a
+    // worst case O(1) cost for both allocation and deallocation.
+    //
+    // Free blocks are kept in segregated lists indexed by two levels: the first level is the power
+    // of two range of the size, the second level splits that range in sl_count linear steps.
+    // A bitmap per level tells which lists are non empty, so finding a big enough free block is
+    // a couple of bit scans, whatever the number of blocks:
+    //
+    //   first level bitmap   |0|1|0|1|...      <- [2^fl, 2^(fl+1)) ranges with free blocks
+    //                           |
+    //   second level bitmap  |0|0|1|0|...|0|   <- sub ranges of 2^fl / sl_count bytes
+    //                               |
+    //                               v
+    //                          free list
+    //
+    // Every block starts with a header holding its size and a pointer to the previous block in
+    // memory (boundary tags), so a freed block is merged with its free neighbours in O(1).
+    //
+    //         _____________________________________________________________
+    // Buffer: |hdr|  payload  |hdr|      payload       |hdr|  payload  |hdr| <- sentinel
+    //         |___|___________|___|____________________|___|___________|___|
+    //
+    template
+    <
+        // The size of the block of memory in bytes
+          size_t         _BufferSize
+        // Whether we allocate the buffer on the first allocation or on construction
+        , BufferInitMode _InitMode
+        // The allocator responsible for providing the memory to the buffer provider
+        , typename       _Allocator
+        // The provider of the underlying block of memory
+        , template<size_t, size_t, BufferInitMode, typename> class _BufferProvider
+    >
+    class tlsf_allocator
+        : public _BufferProvider<_BufferSize, 16_B, _InitMode, _Allocator>
+    {
+        //------------------------------------------------------------------------------------------
+        using buffer_provider_t = _BufferProvider<_BufferSize, 16_B, _InitMode, _Allocator>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Block sizes are multiples of the header size, so every payload is aligned on it
+        static constexpr auto alignment                       = 16_B;
+        //------------------------------------------------------------------------------------------
+        static constexpr auto supports_truncated_deallocation = false;
+
+    private:
+        //------------------------------------------------------------------------------------------
+        struct header
+        {
+            // Previous block in memory
+            header  *pPrevPhysical_;
+            // Size of the payload, the lowest bit tells if the block is free
+            size_t  sizeAndFlags_;
+            // Free list links, only valid when the block is free, they live in the payload
+            header  *pNextFree_;
+            header  *pPrevFree_;
+        };
+
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t header_size     = 2 * sizeof(void*);
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t min_block_size  = sizeof(header) - header_size;
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t free_flag       = 1;
+
+        //------------------------------------------------------------------------------------------
+        // Second level: each power of two range is split in sl_count lists
+        static constexpr size_t sl_count_log2   = 4;
+        static constexpr size_t sl_count        = size_t{ 1 } << sl_count_log2;
+        //------------------------------------------------------------------------------------------
+        // First level: sizes below small_block_size all go in the first range, split linearly
+        static constexpr size_t fl_shift        = sl_count_log2 + 4;
+        static constexpr size_t small_block_size= size_t{ 1 } << fl_shift;
+        static constexpr size_t fl_count        = last_bit_set(_BufferSize) - fl_shift + 2;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // The biggest block the buffer can hold
+        static constexpr size_t max_size        = (_BufferSize & ~(alignment - 1)) - 2 * header_size;
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Invariants
+        static_assert(!is_dynamic_value(_BufferSize)      , "tlsf_allocator needs a static buffer size.");
+        static_assert(header_size == alignment            , "The header must keep the payloads aligned.");
+        static_assert(_BufferSize >= 4 * small_block_size , "Buffer too small to be worth it.");
+        static_assert(fl_count < 64                       , "Buffer too big.");
+
+    public:
+        //------------------------------------------------------------------------------------------
+        tlsf_allocator()
+            : isReady_(false)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Can't be moved nor copied, the free lists point inside the buffer
+        tlsf_allocator(tlsf_allocator &&)       = delete;
+        tlsf_allocator(const tlsf_allocator &)  = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Allocator interface
+        block allocate(size_t size)
+        {
+            if (size == 0 || size > max_size || !ensureReady())
+            {
+                return nullblock;
+            }
+
+            const auto blockSize = adjustSize(size);
+            auto pBlock = findFreeBlock(blockSize);
+            if (pBlock == nullptr)
+            {
+                // Out of memory
+                return nullblock;
+            }
+
+            // The header keeps the real size of the block, which may be a bit bigger if the free
+            // block found was too small to be split
+            removeFree(pBlock);
+            trim(pBlock, blockSize);
+            return block{ payloadOf(pBlock), blockSize };
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate(block &b)
+        {
+            if (b.ptr == nullptr)
+            {
+                return;
+            }
+
+            assert(owns(b));
+            auto pBlock = headerOf(b.ptr);
+            assert(!isFree(pBlock) && "Double free detected.");
+
+            // Merge with the previous block if it is free
+            auto pPrev = pBlock->pPrevPhysical_;
+            if (pPrev && isFree(pPrev))
+            {
+                removeFree(pPrev);
+                pBlock = merge(pPrev, pBlock);
+            }
+
+            // And with the next one
+            auto pNext = nextOf(pBlock);
+            if (isFree(pNext))
+            {
+                removeFree(pNext);
+                pBlock = merge(pBlock, pNext);
+            }
+
+            insertFree(pBlock);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool reallocate(block &b, size_t newSize)
+        {
+            if (handle_common_reallocation_cases(*this, b, newSize))
+            {
+                return true;
+            }
+
+            if (newSize <= max_size && resizeInPlace(b, adjustSize(newSize)))
+            {
+                return true;
+            }
+
+            return reallocate_and_copy(*this, *this, b, newSize);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Grows the block over the next one if it is free
+        bool expand(block &b, size_t delta)
+        {
+            if (delta == 0)
+            {
+                return true;
+            }
+
+            return b.size + delta <= max_size && resizeInPlace(b, adjustSize(b.size + delta));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Sizes are rounded up to the alignment
+        size_t good_size(size_t size) const
+        {
+            return (size != 0 && size <= max_size) ? adjustSize(size) : size;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool owns(const block &b) const
+        {
+            // If the block falls inside the buffer we own it
+            return (begin() <= b.ptr) && (b.ptr < end());
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Allocator augmented interface
+        void deallocateAll()
+        {
+            // The whole buffer becomes one free block again on the next allocation
+            isReady_ = false;
+            buffer_provider_t::decommit();
+        }
+
+    private:
+        // Helpers
+        //------------------------------------------------------------------------------------------
+        inline const uint8_t* begin() const
+        {
+            return buffer_provider_t::buffer_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        inline const uint8_t* end() const
+        {
+            return buffer_provider_t::buffer_ + buffer_provider_t::size();
+        }
+
+        //------------------------------------------------------------------------------------------
+        static size_t adjustSize(size_t size)
+        {
+            return std::max(round_to_alignment(size, alignment), min_block_size);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Block header accessors
+        static size_t   sizeOf(const header *pBlock)        { return pBlock->sizeAndFlags_ & ~free_flag;              }
+        static bool     isFree(const header *pBlock)        { return (pBlock->sizeAndFlags_ & free_flag) != 0;        }
+        static void*    payloadOf(header *pBlock)           { return reinterpret_cast<uint8_t*>(pBlock) + header_size; }
+        static header*  headerOf(void *ptr)                 { return reinterpret_cast<header*>(static_cast<uint8_t*>(ptr) - header_size); }
+        static header*  nextOf(header *pBlock)              { return reinterpret_cast<header*>(static_cast<uint8_t*>(payloadOf(pBlock)) + sizeOf(pBlock)); }
+
+        //------------------------------------------------------------------------------------------
+        static void setSize(header *pBlock, size_t size, bool isBlockFree)
+        {
+            pBlock->sizeAndFlags_ = size | (isBlockFree ? free_flag : 0);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Indices of the list holding blocks of that size
+        static void mapping(size_t size, size_t &fl, size_t &sl)
+        {
+            if (size < small_block_size)
+            {
+                fl = 0;
+                sl = size / (small_block_size / sl_count);
+            }
+            else
+            {
+                const auto bit = fast_last_bit_set(size);
+                sl = (size >> (bit - sl_count_log2)) ^ sl_count;
+                fl = bit - fl_shift + 1;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Finds a free block of at least size bytes. The size is rounded up to the next list so
+        // that the head of any list found is big enough. If there is none, the head of the list
+        // the size falls in may still fit, which matters for the biggest sizes.
+        header* findFreeBlock(size_t size) const
+        {
+            size_t fl, sl;
+            mapping(size >= small_block_size ? size + (size_t{ 1 } << (fast_last_bit_set(size) - sl_count_log2)) - 1 : size, fl, sl);
+
+            if (fl < fl_count)
+            {
+                // First a list of the same range
+                auto slMap = slBitmaps_[fl] & (~size_t{ 0 } << sl);
+                if (slMap == 0)
+                {
+                    // Then the first non empty bigger range
+                    const auto flMap = flBitmap_ & (~size_t{ 0 } << (fl + 1));
+                    fl    = flMap ? count_trailing_zeros(flMap) : fl_count;
+                    slMap = flMap ? slBitmaps_[fl] : 0;
+                }
+                if (slMap != 0)
+                {
+                    return freeLists_[fl][count_trailing_zeros(slMap)];
+                }
+            }
+
+            mapping(size, fl, sl);
+            auto pBlock = freeLists_[fl][sl];
+            return (pBlock && sizeOf(pBlock) >= size) ? pBlock : nullptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void insertFree(header *pBlock)
+        {
+            size_t fl, sl;
+            mapping(sizeOf(pBlock), fl, sl);
+
+            setSize(pBlock, sizeOf(pBlock), true);
+            pBlock->pPrevFree_ = nullptr;
+            pBlock->pNextFree_ = freeLists_[fl][sl];
+            if (pBlock->pNextFree_)
+            {
+                pBlock->pNextFree_->pPrevFree_ = pBlock;
+            }
+            freeLists_[fl][sl] = pBlock;
+            flBitmap_      |= size_t{ 1 } << fl;
+            slBitmaps_[fl] |= size_t{ 1 } << sl;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void removeFree(header *pBlock)
+        {
+            size_t fl, sl;
+            mapping(sizeOf(pBlock), fl, sl);
+
+            if (pBlock->pPrevFree_)
+            {
+                pBlock->pPrevFree_->pNextFree_ = pBlock->pNextFree_;
+            }
+            else
+            {
+                freeLists_[fl][sl] = pBlock->pNextFree_;
+            }
+            if (pBlock->pNextFree_)
+            {
+                pBlock->pNextFree_->pPrevFree_ = pBlock->pPrevFree_;
+            }
+            if (freeLists_[fl][sl] == nullptr)
+            {
+                slBitmaps_[fl] &= ~(size_t{ 1 } << sl);
+                if (slBitmaps_[fl] == 0)
+                {
+                    flBitmap_ &= ~(size_t{ 1 } << fl);
+                }
+            }
+            setSize(pBlock, sizeOf(pBlock), false);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Absorbs pNext, which must directly follow pBlock in memory, into pBlock
+        static header* merge(header *pBlock, header *pNext)
+        {
+            setSize(pBlock, sizeOf(pBlock) + header_size + sizeOf(pNext), false);
+            nextOf(pBlock)->pPrevPhysical_ = pBlock;
+            return pBlock;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Gives the end of a used block back to the free lists if it is big enough to be a block
+        void trim(header *pBlock, size_t size)
+        {
+            const auto blockSize = sizeOf(pBlock);
+            if (blockSize < size + header_size + min_block_size)
+            {
+                return;
+            }
+
+            setSize(pBlock, size, false);
+            auto pRemainder = nextOf(pBlock);
+            pRemainder->pPrevPhysical_ = pBlock;
+            setSize(pRemainder, blockSize - size - header_size, false);
+
+            // The remainder may be followed by a free block
+            auto pNext = nextOf(pRemainder);
+            pNext->pPrevPhysical_ = pRemainder;
+            if (isFree(pNext))
+            {
+                removeFree(pNext);
+                pRemainder = merge(pRemainder, pNext);
+            }
+            insertFree(pRemainder);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Shrinks the block or grows it over the next block if that one is free and big enough
+        bool resizeInPlace(block &b, size_t size)
+        {
+            auto pBlock = headerOf(b.ptr);
+
+            if (size > sizeOf(pBlock))
+            {
+                auto pNext = nextOf(pBlock);
+                if (!isFree(pNext) || sizeOf(pBlock) + header_size + sizeOf(pNext) < size)
+                {
+                    return false;
+                }
+                removeFree(pNext);
+                merge(pBlock, pNext);
+            }
+
+            trim(pBlock, size);
+            b.size = size;
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Lazily turns the whole buffer into one free block followed by a sentinel
+        bool ensureReady()
+        {
+            if (isReady_)
+            {
+                return true;
+            }
+
+            // Lazy init
+            uint8_t *p = nullptr;
+            buffer_provider_t::init(p);
+
+            // Headers are written everywhere in the buffer, it has to be fully backed
+            if (buffer_provider_t::buffer_ == nullptr || !buffer_provider_t::commit(end()))
+            {
+                return false;
+            }
+
+            flBitmap_ = 0;
+            std::fill(std::begin(slBitmaps_), std::end(slBitmaps_), size_t{ 0 });
+            for (auto &lists : freeLists_)
+            {
+                std::fill(std::begin(lists), std::end(lists), nullptr);
+            }
+
+            auto pFirst = reinterpret_cast<header*>(buffer_provider_t::buffer_);
+            pFirst->pPrevPhysical_ = nullptr;
+            setSize(pFirst, max_size, false);
+
+            // The sentinel is a used empty block, it stops the merges at the end of the buffer
+            auto pSentinel = nextOf(pFirst);
+            pSentinel->pPrevPhysical_ = pFirst;
+            setSize(pSentinel, 0, false);
+
+            insertFree(pFirst);
+
+            isReady_ = true;
+            return true;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // One bit per first level range, set if any of its lists isn't empty
+        size_t  flBitmap_;
+        // One bit per list of each first level range, set if the list isn't empty
+        size_t  slBitmaps_[fl_count];
+        // Free blocks of each size range
+        header  *freeLists_[fl_count][sl_count];
+        // Whether the free lists have been set up
+        bool    isReady_;
+    };
+
+    //------------------------------------------------------------------------------------------
+    // Shortcut to a TLSF allocator using a buffer on the stack
+    template<size_t _BufferSize>
+    using stack_tlsf_allocator = tlsf_allocator<_BufferSize, BufferInitMode::InitOnConstruct, void, stack_buffer_provider>;
+
+    //------------------------------------------------------------------------------------------
+    // Shortcut to a TLSF allocator using a buffer on the heap
+    template<size_t _BufferSize, BufferInitMode _InitMode = BufferInitMode::InitOnConstruct, typename _Allocator = mallocator>
+    using heap_tlsf_allocator = tlsf_allocator<_BufferSize, _InitMode, _Allocator, heap_buffer_provider>;
+
+} /*abb*/
@@ -0,0 +1,403 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+
+#include "abb/block.hpp"
+#include "abb/size_helpers.hpp"
+#include "abb/batch_helpers.hpp"
+#include "abb/reallocation_helpers.hpp"
+#include "abb/aligned_helpers.hpp"
+
+
+namespace abb {
+
+    //----------------------------------------------------------------------------------------------
+    enum class TraceEventType : uint8_t
+    {
+        Allocate,
+        Deallocate,
+        // Recorded before the call, the block given may be freed from then on.
+        // Also records the expansions, which keep the block in place
+        Reallocate,
+        // Recorded after the call, the block returned is only taken from then on
+        Reallocated,
+        DeallocateAll,
+    };
+
+    //----------------------------------------------------------------------------------------------
+    // One record of a trace file. Blocks are identified by their address at recording time, which
+    // is unique among the live blocks, 0 is no block (e.g. a failed allocation).
+    // Deallocations are timestamped before the block is given back, allocations after it was
+    // taken, so that ordering the events by timestamp never shows an address taken twice.
+    // A reallocation is a Reallocate event followed by a Reallocated one from the same thread.
+    struct trace_event
+    {
+        // Nanoseconds since the recording started
+        uint64_t        timestamp;
+        // The block given to the allocator, or the allocated one
+        uint64_t        blockId;
+        // The block after a reallocation (Reallocated)
+        uint64_t        newBlockId;
+        // Requested size for allocations and reallocations, block size for deallocations
+        uint64_t        size;
+        uint32_t        threadId;
+        TraceEventType  type;
+    };
+
+    //----------------------------------------------------------------------------------------------
+    // A trace file is this header followed by trace_event records until the end of the file
+    struct trace_header
+    {
+        static constexpr uint32_t current_magic     = 0x54424241; // "ABBT"
+        static constexpr uint32_t current_version   = 2;
+
+        uint32_t magic      = current_magic;
+        uint32_t version    = current_version;
+        uint32_t eventSize  = sizeof(trace_event);
+        uint32_t reserved   = 0;
+    };
+
+    namespace details {
+
+        //------------------------------------------------------------------------------------------
+        inline std::FILE* open_trace_file(const char *path, const char *mode)
+        {
+#if defined(_WIN32)
+            std::FILE *pFile = nullptr;
+            return fopen_s(&pFile, path, mode) == 0 ? pFile : nullptr;
+#else
+            return std::fopen(path, mode);
+#endif
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Reads a whole trace file and orders its events by timestamp, returns false if it can't be
+    // read or isn't a trace
+    inline bool read_trace(const char *path, std::vector<trace_event> &events)
+    {
+        auto pFile = details::open_trace_file(path, "rb");
+        if (pFile == nullptr)
+        {
+            return false;
+        }
+
+        trace_header header;
+        const bool isTrace = std::fread(&header, sizeof(header), 1, pFile) == 1
+            && header.magic == trace_header::current_magic
+            && header.version == trace_header::current_version
+            && header.eventSize == sizeof(trace_event);
+
+        trace_event event;
+        while (isTrace && std::fread(&event, sizeof(event), 1, pFile) == 1)
+        {
+            events.push_back(event);
+        }
+
+        std::fclose(pFile);
+
+        // Each thread's events are written in order, but the threads flush their events in batches
+        std::stable_sort(events.begin(), events.end(), [](const trace_event &lhs, const trace_event &rhs) { return lhs.timestamp < rhs.timestamp; });
+        return isTrace;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Writes every allocate/deallocate/reallocate going through the allocator to a trace file, to
+    // replay production traffic offline against other compositions (cf. abb_replay).
+    // Nothing is recorded until startRecording. Each thread buffers its events and writes them by
+    // batches, the file is only locked once per batch.
+    // Safe to share between threads if the allocator is.
+    template
+    <
+        // The allocator to record
+        typename _Allocator,
+        // Number of events buffered before writing them
+        size_t _BufferedEvents = 4096
+    >
+    class trace_recorder
+        : public _Allocator
+    {
+        //------------------------------------------------------------------------------------------
+        // The events of one thread, only locked by another thread when the recording stops
+        struct thread_buffer
+        {
+            std::mutex                  mutex;
+            std::thread::id             owner;
+            std::vector<trace_event>    events;
+        };
+
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto alignment = _Allocator::alignment;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        trace_recorder() = default;
+
+        //------------------------------------------------------------------------------------------
+        ~trace_recorder()
+        {
+            stopRecording();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Can't be copied
+        trace_recorder(const trace_recorder &) = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        block allocate(size_t size)
+        {
+            block b = _Allocator::allocate(size);
+            record(TraceEventType::Allocate, blockId(b), 0, size);
+            return b;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate(block &b)
+        {
+            record(TraceEventType::Deallocate, blockId(b), 0, b.size);
+            _Allocator::deallocate(b);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The old block may be freed during the call, and the new one taken
+        bool reallocate(block &b, size_t newSize)
+        {
+            const auto oldId    = blockId(b);
+            record(TraceEventType::Reallocate, oldId, 0, newSize);
+            const bool success  = _Allocator::reallocate(b, newSize);
+            record(TraceEventType::Reallocated, oldId, blockId(b), newSize);
+            return success;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool expand(block &b, size_t delta)
+        {
+            const bool success = abb::expand(static_cast<_Allocator&>(*this), b, delta);
+            if (success)
+            {
+                record(TraceEventType::Reallocate, blockId(b), 0, b.size);
+                record(TraceEventType::Reallocated, blockId(b), blockId(b), b.size);
+            }
+            return success;
+        }
+
+        //------------------------------------------------------------------------------------------
+        size_t good_size(size_t size) const
+        {
+            return abb::good_size(static_cast<const _Allocator&>(*this), size);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Replayed as a plain allocation
+        block allocate_aligned(size_t size, size_t blockAlignment)
+        {
+            block b = abb::allocate_aligned(static_cast<_Allocator&>(*this), size, blockAlignment);
+            record(TraceEventType::Allocate, blockId(b), 0, size);
+            return b;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocateAll()
+        {
+            record(TraceEventType::DeallocateAll, 0, 0, 0);
+            _Allocator::deallocateAll();
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Batch interface, recorded block by block
+        size_t allocate_n(size_t size, block *blocks, size_t count)
+        {
+            const auto allocated = abb::allocate_n(static_cast<_Allocator&>(*this), size, blocks, count);
+            for (size_t i = 0; i < allocated; ++i)
+            {
+                record(TraceEventType::Allocate, blockId(blocks[i]), 0, size);
+            }
+            return allocated;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate_n(block *blocks, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                record(TraceEventType::Deallocate, blockId(blocks[i]), 0, blocks[i].size);
+            }
+            abb::deallocate_n(static_cast<_Allocator&>(*this), blocks, count);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Starts writing a new trace file, replacing the current one if any
+        bool startRecording(const char *path)
+        {
+            stopRecording();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            pFile_ = details::open_trace_file(path, "wb");
+            if (pFile_ == nullptr)
+            {
+                return false;
+            }
+
+            const trace_header header;
+            std::fwrite(&header, sizeof(header), 1, pFile_);
+
+            // Drops what threads recorded while the previous recording stopped
+            for (auto &pBuffer : buffers_)
+            {
+                std::lock_guard<std::mutex> bufferLock(pBuffer->mutex);
+                pBuffer->events.clear();
+            }
+
+            start_.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+            recording_.store(true, std::memory_order_release);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Writes the buffered events of every thread and closes the trace file
+        void stopRecording()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pFile_)
+            {
+                recording_.store(false, std::memory_order_release);
+                for (auto &pBuffer : buffers_)
+                {
+                    std::lock_guard<std::mutex> bufferLock(pBuffer->mutex);
+                    write(pBuffer->events);
+                    pBuffer->events.clear();
+                }
+                std::fclose(pFile_);
+                pFile_ = nullptr;
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        void record(TraceEventType type, uint64_t id, uint64_t newId, size_t size)
+        {
+            if (!recording_.load(std::memory_order_acquire))
+            {
+                return;
+            }
+
+            trace_event event{};
+            event.timestamp     = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch() - std::chrono::steady_clock::duration(start_.load(std::memory_order_relaxed))).count());
+            event.blockId       = id;
+            event.newBlockId    = newId;
+            event.size          = size;
+            event.threadId      = threadId();
+            event.type          = type;
+
+            // A full buffer is handed over, the file is written without holding the thread's buffer
+            std::vector<trace_event> batch;
+            auto &buffer = threadBuffer();
+            {
+                std::lock_guard<std::mutex> bufferLock(buffer.mutex);
+                buffer.events.push_back(event);
+                if (buffer.events.size() < _BufferedEvents)
+                {
+                    return;
+                }
+                batch.reserve(_BufferedEvents);
+                batch.swap(buffer.events);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pFile_)
+            {
+                write(batch);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void write(const std::vector<trace_event> &events)
+        {
+            std::fwrite(events.data(), sizeof(trace_event), events.size(), pFile_);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The calling thread's buffer, the last one used is cached
+        thread_buffer& threadBuffer()
+        {
+            struct cached_buffer
+            {
+                uint64_t        recorderId;
+                thread_buffer   *pBuffer;
+            };
+            static thread_local cached_buffer cache{ 0, nullptr };
+
+            if (cache.recorderId != recorderId_)
+            {
+                cache = cached_buffer{ recorderId_, &findThreadBuffer() };
+            }
+            return *cache.pBuffer;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Buffers are kept until the recorder is destroyed, a thread gets its own back
+        thread_buffer& findThreadBuffer()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto owner = std::this_thread::get_id();
+            for (auto &pBuffer : buffers_)
+            {
+                if (pBuffer->owner == owner)
+                {
+                    return *pBuffer;
+                }
+            }
+
+            buffers_.push_back(std::make_unique<thread_buffer>());
+            buffers_.back()->owner = owner;
+            buffers_.back()->events.reserve(_BufferedEvents);
+            return *buffers_.back();
+        }
+
+        //------------------------------------------------------------------------------------------
+        static uint64_t blockId(const block &b)
+        {
+            return reinterpret_cast<uintptr_t>(b.ptr);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Threads are numbered in the order they first get recorded
+        static uint32_t threadId()
+        {
+            static std::atomic<uint32_t> nextId(0);
+            static thread_local const uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+            return id;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Tells the recorders apart in the threads' caches, even once one is destroyed
+        static uint64_t nextRecorderId()
+        {
+            static std::atomic<uint64_t> nextId(1);
+            return nextId.fetch_add(1, std::memory_order_relaxed);
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        std::mutex                                  mutex_;
+        std::atomic<bool>                           recording_  { false };
+        std::FILE                                   *pFile_     = nullptr;
+        std::vector<std::unique_ptr<thread_buffer>> buffers_;
+        // Read without the lock by threads still recording when a new recording starts
+        std::atomic<std::chrono::steady_clock::rep> start_      { 0 };
+        const uint64_t                              recorderId_ = nextRecorderId();
+    };
+
+} /*abb*/
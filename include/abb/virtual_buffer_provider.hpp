@@ -0,0 +1,230 @@
+#pragma once
+
+#if defined(_WIN32)
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <sys/mman.h>
+#endif
+
+#include <cassert>
+#include "abb/block.hpp"
+#include "abb/units.hpp"
+#include "abb/range_helpers.hpp"
+#include "abb/buffer_provider.hpp"
+
+
+namespace abb {
+
+    //----------------------------------------------------------------------------------------------
+    // Virtual memory buffer provider
+    //
+    // Reserves _BufferSize bytes of address space without backing them with memory. Pages are
+    // committed as the allocator on top of it moves forward (cf. commit), and given back to the
+    // system on deallocateAll (cf. decommit). A huge buffer (e.g. 64 GiB) then only costs the
+    // memory that is actually touched.
+    //
+    //          ______________________________________________________
+    // Buffer: |committed pages|           reserved address space     |
+    //         |XXXXXXXXX______|______________________________________|
+    //                  ^      ^
+    //               cursor  committed end, moved by steps of commit_granularity
+    //
+    // Committing isn't thread safe, this provider is meant for linear_allocator.
+    //
+    template
+    <
+        // The size of the address range to reserve
+          size_t         _BufferSize
+        // Alignment of the buffer, the buffer is page aligned which must satisfy it
+        , size_t         _Alignment
+        // Whether we reserve the address range on creation or on the first allocate
+        , BufferInitMode _InitMode
+        // The memory comes from the system so no need for an allocator
+        , typename
+    >
+    struct virtual_buffer_provider
+        : public std::conditional
+            <
+                is_dynamic_value(_BufferSize)
+                , dynamic_value_t<size_t>
+                , static_value_t<size_t, _BufferSize>
+            >::type
+    {
+        //------------------------------------------------------------------------------------------
+        using value_type_t = typename std::conditional<is_dynamic_value(_BufferSize), dynamic_value_t<size_t>, static_value_t<size_t, _BufferSize>>::type;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Pages are committed by chunks of this size to limit the number of system calls
+        static constexpr auto commit_granularity = 64_KiB;
+
+        //------------------------------------------------------------------------------------------
+        static_assert(_Alignment <= 4_KiB, "Pages can't guarantee an alignment above 4 KiB.");
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Default constructor available for both dynamic and static sizes
+        virtual_buffer_provider()
+            : buffer_(is_lazy_init(_InitMode) || is_dynamic_value(_BufferSize) ? nullptr : reserve(_BufferSize))
+            , committedEnd_(buffer_)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // This constructor is enabled only if we are dynamically sizing our buffer
+        template<enable_if_workaround_t(is_dynamic_value(_BufferSize))>
+        explicit virtual_buffer_provider(size_t dynamicBufferSize)
+            : value_type_t(dynamicBufferSize)
+            , buffer_(is_lazy_init(_InitMode) ? nullptr : reserve(value_type_t::value()))
+            , committedEnd_(buffer_)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Can be moved
+        virtual_buffer_provider(virtual_buffer_provider &&rhs)
+            : value_type_t(rhs)
+            , buffer_(rhs.buffer_)
+            , committedEnd_(rhs.committedEnd_)
+        {
+            rhs.buffer_       = nullptr;
+            rhs.committedEnd_ = nullptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Can't be copied
+        virtual_buffer_provider(const virtual_buffer_provider &) = delete;
+
+        //------------------------------------------------------------------------------------------
+        ~virtual_buffer_provider()
+        {
+            if (buffer_)
+            {
+                release(buffer_, size());
+                buffer_ = nullptr;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void init(uint8_t *&ptr)
+        {
+            if (is_lazy_init(_InitMode) && !buffer_)
+            {
+                assert(value_type_t::is_set());
+                buffer_       = reserve(size());
+                committedEnd_ = buffer_;
+                ptr = buffer_;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        constexpr size_t size() const
+        {
+            return value_type_t::value();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Makes sure that the memory up to pEnd can be used
+        bool commit(const uint8_t *pEnd)
+        {
+            if (pEnd <= committedEnd_)
+            {
+                return true;
+            }
+
+            const auto usedSize      = static_cast<size_t>(pEnd - buffer_);
+            const auto committedSize = std::min(round_to_alignment(usedSize, commit_granularity), size());
+            const auto pNewEnd       = buffer_ + committedSize;
+
+            if (!commitRange(committedEnd_, pNewEnd - committedEnd_))
+            {
+                // Out of memory
+                return false;
+            }
+
+            committedEnd_ = pNewEnd;
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Gives every committed page back to the system, the address range stays reserved
+        void decommit()
+        {
+            if (committedEnd_ != buffer_)
+            {
+                decommitRange(buffer_, committedEnd_ - buffer_);
+                committedEnd_ = buffer_;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // How much memory is currently backing the buffer
+        size_t committed_size() const
+        {
+            return committedEnd_ - buffer_;
+        }
+
+    private:
+        // System calls
+#if defined(_WIN32)
+        //------------------------------------------------------------------------------------------
+        static uint8_t* reserve(size_t size)
+        {
+            return static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS));
+        }
+
+        //------------------------------------------------------------------------------------------
+        static bool commitRange(uint8_t *ptr, size_t size)
+        {
+            return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void decommitRange(uint8_t *ptr, size_t size)
+        {
+            VirtualFree(ptr, size, MEM_DECOMMIT);
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void release(uint8_t *ptr, size_t)
+        {
+            VirtualFree(ptr, 0, MEM_RELEASE);
+        }
+#else
+        //------------------------------------------------------------------------------------------
+        static uint8_t* reserve(size_t size)
+        {
+            auto ptr = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            return ptr == MAP_FAILED ? nullptr : static_cast<uint8_t*>(ptr);
+        }
+
+        //------------------------------------------------------------------------------------------
+        static bool commitRange(uint8_t *ptr, size_t size)
+        {
+            return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void decommitRange(uint8_t *ptr, size_t size)
+        {
+            // Drop the pages first so that they don't count in the resident set anymore
+            madvise(ptr, size, MADV_DONTNEED);
+            mprotect(ptr, size, PROT_NONE);
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void release(uint8_t *ptr, size_t size)
+        {
+            munmap(ptr, size);
+        }
+#endif
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        uint8_t *buffer_;
+        // End of the memory that can actually be used
+        uint8_t *committedEnd_;
+    };
+
+} /*abb*/
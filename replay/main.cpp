@@ -0,0 +1,380 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+#include "abb.hpp"
+
+//--------------------------------------------------------------------------------------------------
+using namespace abb::units;
+
+
+//--------------------------------------------------------------------------------------------------
+// Bytes the compositions take from the system
+struct footprint
+{
+    static size_t live;
+    static size_t peak;
+
+    //----------------------------------------------------------------------------------------------
+    static void add(size_t size)
+    {
+        live += size;
+        peak = std::max(peak, live);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    static void reset()
+    {
+        live = 0;
+        peak = 0;
+    }
+};
+
+size_t footprint::live = 0;
+size_t footprint::peak = 0;
+
+//--------------------------------------------------------------------------------------------------
+// The system allocator at the bottom of every composition, measuring the footprint.
+// malloc's own overhead can't be seen from here.
+// _Id tells apart the instances a composition inherits from more than once.
+template<size_t _Id = 0>
+class counting_mallocator
+    : public abb::mallocator
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    abb::block allocate(size_t size)
+    {
+        auto b = abb::mallocator::allocate(size);
+        if (b.ptr)
+        {
+            footprint::add(b.size);
+        }
+        return b;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    void deallocate(abb::block &b)
+    {
+        footprint::live -= b.ptr ? b.size : 0;
+        abb::mallocator::deallocate(b);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool reallocate(abb::block &b, size_t newSize)
+    {
+        if (abb::handle_common_reallocation_cases(*this, b, newSize))
+        {
+            return true;
+        }
+
+        const auto oldSize = b.size;
+        if (!abb::mallocator::reallocate(b, newSize))
+        {
+            return false;
+        }
+        footprint::live -= oldSize;
+        footprint::add(b.size);
+        return true;
+    }
+};
+
+
+//--------------------------------------------------------------------------------------------------
+// The compositions a trace can be replayed against
+using freelist_t        = abb::freelist<counting_mallocator<>, abb::dynamic_range_t, 1024, 32>;
+using pow2_buckets_t    = abb::segregator<256_B, abb::bucketizer<freelist_t, abb::pow2_range_raider<16_B, 256_B>>, counting_mallocator<>>;
+using geometric_t       = abb::segregator<4_KiB, abb::bucketizer<freelist_t, abb::geometric_range_raider<16_B, 4_KiB, 4>>, counting_mallocator<>>;
+using tlsf_t            = abb::fallback_allocator<abb::heap_tlsf_allocator<16_MiB, abb::BufferInitMode::InitOnFirstAllocation, counting_mallocator<1>>, counting_mallocator<>>;
+
+
+//--------------------------------------------------------------------------------------------------
+// A trace event with its block ids resolved to slots, the blocks of a replay being kept in an array
+// indexed by slot. Every block allocated or returned by a reallocation gets its own slot.
+struct replay_op
+{
+    static constexpr uint32_t no_slot = ~uint32_t{ 0 };
+
+    abb::TraceEventType type;
+    // Reallocated: whether the reallocation returned a block
+    bool                returnsBlock;
+    // The slot of the block, DeallocateAll is split in one op per block live at that point
+    uint32_t            slot;
+    // Reallocate: the slot of the block given, no_slot if it isn't known
+    uint32_t            sourceSlot;
+    // Allocate and Reallocate: the requested size
+    uint64_t            size;
+};
+
+//--------------------------------------------------------------------------------------------------
+struct replay_script
+{
+    std::vector<replay_op>  ops;
+    size_t                  slotCount;
+};
+
+//--------------------------------------------------------------------------------------------------
+// Resolves the block ids once for all the compositions, so that replaying doesn't touch any map
+replay_script compile_trace(const std::vector<abb::trace_event> &events)
+{
+    replay_script script{ {}, 0 };
+    script.ops.reserve(events.size());
+
+    std::unordered_map<uint64_t, uint32_t> slots;
+    // The reallocations each thread started, their block is known once they end
+    std::unordered_map<uint32_t, uint32_t> reallocations;
+
+    auto newSlot = [&script]() { return static_cast<uint32_t>(script.slotCount++); };
+
+    for (const auto &event : events)
+    {
+        switch (event.type)
+        {
+        case abb::TraceEventType::Allocate:
+            if (event.blockId != 0)
+            {
+                const auto slot = newSlot();
+                slots[event.blockId] = slot;
+                script.ops.push_back(replay_op{ event.type, false, slot, replay_op::no_slot, event.size });
+            }
+            break;
+
+        case abb::TraceEventType::Deallocate:
+            if (auto it = slots.find(event.blockId); it != slots.end())
+            {
+                script.ops.push_back(replay_op{ event.type, false, it->second, replay_op::no_slot, 0 });
+                slots.erase(it);
+            }
+            break;
+
+        case abb::TraceEventType::Reallocate:
+        {
+            auto sourceSlot = replay_op::no_slot;
+            if (auto it = slots.find(event.blockId); it != slots.end())
+            {
+                sourceSlot = it->second;
+                slots.erase(it);
+            }
+            const auto slot = newSlot();
+            reallocations[event.threadId] = slot;
+            script.ops.push_back(replay_op{ event.type, false, slot, sourceSlot, event.size });
+            break;
+        }
+
+        case abb::TraceEventType::Reallocated:
+            if (auto it = reallocations.find(event.threadId); it != reallocations.end())
+            {
+                if (event.newBlockId != 0)
+                {
+                    slots[event.newBlockId] = it->second;
+                }
+                script.ops.push_back(replay_op{ event.type, event.newBlockId != 0, it->second, replay_op::no_slot, 0 });
+                reallocations.erase(it);
+            }
+            break;
+
+        case abb::TraceEventType::DeallocateAll:
+            for (auto &entry : slots)
+            {
+                script.ops.push_back(replay_op{ event.type, false, entry.second, replay_op::no_slot, 0 });
+            }
+            slots.clear();
+            break;
+        }
+    }
+    return script;
+}
+
+//--------------------------------------------------------------------------------------------------
+struct replayed_block
+{
+    enum class State : uint8_t
+    {
+        Empty,
+        Live,
+        // Given by a reallocation that hasn't returned yet
+        Reallocating,
+    };
+
+    abb::block  b;
+    size_t      requestedSize;
+    State       state;
+};
+
+//--------------------------------------------------------------------------------------------------
+struct replay_result
+{
+    double  seconds;
+    size_t  operations;
+    size_t  peakLive;
+    size_t  peakFootprint;
+};
+
+//--------------------------------------------------------------------------------------------------
+// Replays the ops in order on the calling thread. Live bytes are the requested ones.
+// Only the allocator calls and the slot bookkeeping are timed.
+// Blocks still live at the end of the trace are deallocated once the measures are taken.
+template<typename _Allocator>
+replay_result replay(const replay_script &script)
+{
+    using State = replayed_block::State;
+
+    footprint::reset();
+
+    auto pAllocator = std::make_unique<_Allocator>();
+    auto &allocator = *pAllocator;
+
+    std::vector<replayed_block> blocks(script.slotCount, replayed_block{ abb::block{ nullptr, 0 }, 0, State::Empty });
+
+    size_t live         = 0;
+    size_t peakLive     = 0;
+    size_t operations   = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto &op : script.ops)
+    {
+        auto &rb = blocks[op.slot];
+        switch (op.type)
+        {
+        case abb::TraceEventType::Allocate:
+            rb = replayed_block{ allocator.allocate(op.size), op.size, State::Live };
+            live += op.size;
+            ++operations;
+            break;
+
+        case abb::TraceEventType::Deallocate:
+            if (rb.state == State::Live)
+            {
+                live -= rb.requestedSize;
+                allocator.deallocate(rb.b);
+                rb.state = State::Empty;
+                ++operations;
+            }
+            break;
+
+        case abb::TraceEventType::Reallocate:
+        {
+            auto b = abb::block{ nullptr, 0 };
+            if (op.sourceSlot != replay_op::no_slot && blocks[op.sourceSlot].state == State::Live)
+            {
+                auto &source = blocks[op.sourceSlot];
+                live -= source.requestedSize;
+                b = source.b;
+                source.state = State::Empty;
+            }
+            allocator.reallocate(b, op.size);
+            rb = replayed_block{ b, op.size, State::Reallocating };
+            ++operations;
+            break;
+        }
+
+        case abb::TraceEventType::Reallocated:
+            if (op.returnsBlock && rb.b.ptr)
+            {
+                live += rb.requestedSize;
+                rb.state = State::Live;
+            }
+            else
+            {
+                rb.state = State::Empty;
+            }
+            break;
+
+        case abb::TraceEventType::DeallocateAll:
+            // Only a linear allocator could give its blocks back at once, free them one by one
+            if (rb.state == State::Live)
+            {
+                live -= rb.requestedSize;
+                allocator.deallocate(rb.b);
+                rb.state = State::Empty;
+            }
+            break;
+        }
+        peakLive = std::max(peakLive, live);
+    }
+    const auto stop = std::chrono::steady_clock::now();
+
+    replay_result result{ std::chrono::duration<double>(stop - start).count(), operations, peakLive, footprint::peak };
+
+    for (auto &rb : blocks)
+    {
+        if ((rb.state == State::Live) || (rb.state == State::Reallocating && rb.b.ptr))
+        {
+            allocator.deallocate(rb.b);
+        }
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+struct composition
+{
+    const char      *name;
+    replay_result   (*replay)(const replay_script &);
+};
+
+//--------------------------------------------------------------------------------------------------
+const composition compositions[] =
+{
+    { "mallocator",     &replay<counting_mallocator<>> },
+    { "pow2_buckets",   &replay<pow2_buckets_t> },
+    { "geometric",      &replay<geometric_t> },
+    { "tlsf",           &replay<tlsf_t> },
+};
+
+
+//--------------------------------------------------------------------------------------------------
+void print_usage()
+{
+    std::printf("usage: abb_replay <trace file> [composition...]\n");
+    std::printf("Replays a trace written by abb::trace_recorder against each composition (all by default):\n");
+    for (const auto &c : compositions)
+    {
+        std::printf("  %s\n", c.name);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<abb::trace_event> events;
+    if (!abb::read_trace(argv[1], events))
+    {
+        std::printf("%s is not a readable trace file\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    std::printf("%zu events\n", events.size());
+    const auto script = compile_trace(events);
+
+    // Fragmentation is the share of the footprint that never held live bytes at the peak
+    std::printf("%-16s %10s %12s %14s %14s %14s\n", "composition", "ms", "ns/op", "peak live", "peak footprint", "fragmentation");
+    for (const auto &c : compositions)
+    {
+        bool selected = (argc == 2);
+        for (int i = 2; i < argc; ++i)
+        {
+            selected |= (std::strcmp(argv[i], c.name) == 0);
+        }
+        if (!selected)
+        {
+            continue;
+        }
+
+        const auto r = c.replay(script);
+        const auto fragmentation = r.peakFootprint ? 100.0 * (1.0 - double(r.peakLive) / r.peakFootprint) : 0.0;
+        std::printf("%-16s %10.2f %12.2f %14zu %14zu %13.1f%%\n", c.name, r.seconds * 1e3, r.seconds * 1e9 / std::max<size_t>(r.operations, 1), r.peakLive, r.peakFootprint, fragmentation);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+#include <new>
+#include <limits>
+#include <cstdlib>
+
+#include "abb.hpp"
+
+//--------------------------------------------------------------------------------------------------
+using namespace abb::units;
+
+//--------------------------------------------------------------------------------------------------
+// Every new and delete of this executable goes through this composition, it has its own binary so
+// that the other tests keep the default global operators
+namespace abb {
+    using global_freelist_t     = freelist<mallocator, dynamic_range_t, 1024, 16>;
+    using global_allocator_t    = locked_allocator<stats_collector<segregator<1_KiB, bucketizer<global_freelist_t, pow2_range_raider<16_B, 1_KiB>>, mallocator>>>;
+}
+#include "abb/global_new_delete.hpp"
+
+
+//--------------------------------------------------------------------------------------------------
+void test_global_new_delete()
+{
+    // Keeps the compiler from eliding the new and delete pairs
+    [[maybe_unused]] static void * volatile sink = nullptr;
+    auto &allocator = abb::global_heap<abb::global_allocator_t>::instance().allocator();
+    const auto before = allocator.stats();
+
+    // Sized delete
+    auto pInt = new int(42);
+    sink = pInt;
+    assert(allocator.stats().allocations == before.allocations + 1);
+    delete pInt;
+
+    // Unsized delete, the size comes from the header
+    auto pRaw = ::operator new(100);
+    sink = pRaw;
+    ::operator delete(pRaw);
+
+    // Too big for the freelists, goes to the mallocator
+    auto pArray = new char[4_KiB];
+    sink = pArray;
+    delete[] pArray;
+
+    auto pNothrow = new (std::nothrow) int[16];
+    sink = pNothrow;
+    assert(pNothrow != nullptr);
+    ::operator delete[](pNothrow, std::nothrow);
+
+    // Over-aligned
+    struct alignas(128) over_aligned_t { char bytes[200]; };
+    auto pAligned = new over_aligned_t;
+    sink = pAligned;
+    assert(reinterpret_cast<uintptr_t>(pAligned) % 128 == 0);
+    delete pAligned;
+
+    auto pAlignedArray = new (std::nothrow) over_aligned_t[3];
+    sink = pAlignedArray;
+    assert(reinterpret_cast<uintptr_t>(pAlignedArray) % 128 == 0);
+    delete[] pAlignedArray;
+
+    // Distinct blocks for empty requests
+    auto pEmpty0 = ::operator new(0);
+    auto pEmpty1 = ::operator new(0);
+    assert(pEmpty0 != pEmpty1);
+    ::operator delete(pEmpty0, size_t{ 0 });
+    ::operator delete(pEmpty1);
+
+    sink = nullptr;
+    const auto after = allocator.stats();
+    assert(after.allocations == before.allocations + 8);
+    assert(after.deallocations == before.deallocations + 8);
+    assert(after.bytesLive == before.bytesLive);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_global_new_delete_out_of_memory()
+{
+    constexpr size_t hugeSize = size_t{ 1 } << 60;
+    constexpr size_t maxSize  = std::numeric_limits<size_t>::max();
+
+    // Too big for the composition
+    assert(::operator new(hugeSize, std::nothrow) == nullptr);
+    assert(::operator new[](hugeSize, std::nothrow) == nullptr);
+    assert(::operator new(hugeSize, std::align_val_t{ 128 }, std::nothrow) == nullptr);
+
+    // The header or the padding would wrap the size around
+    assert(::operator new(maxSize, std::nothrow) == nullptr);
+    assert(::operator new(maxSize - 8, std::align_val_t{ 128 }, std::nothrow) == nullptr);
+
+    // The new handler is called until it gives up
+    static int handlerCalls = 0;
+    std::set_new_handler([] { if (++handlerCalls == 3) { std::set_new_handler(nullptr); } });
+    bool threw = false;
+    try
+    {
+        ::operator delete(::operator new(hugeSize));
+    }
+    catch (const std::bad_alloc &)
+    {
+        threw = true;
+    }
+    assert(threw && handlerCalls == 3);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+int main()
+{
+    test_global_new_delete();
+    test_global_new_delete_out_of_memory();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -1,4 +1,10 @@
+#include <list>
+#include <array>
+#include <thread>
+#include <vector>
 #include <iostream>
+#include <memory_resource>
+#include <unordered_map>
 
 #include "abb.hpp"
 
@@ -26,12 +32,1194 @@ void test_linear_allocator()
     b2 = allocator.allocate(20);
     assert(b2.size >= 20);
 }
+//--------------------------------------------------------------------------------------------------
+void test_virtual_linear_allocator()
+{
+    using alloc_t = abb::virtual_linear_allocator<64_GiB>;
+    alloc_t allocator;
+
+    // Nothing is backed until we allocate
+    assert(allocator.committed_size() == 0);
+
+    auto b0 = allocator.allocate(100);
+    assert(b0.size >= 100);
+    memset(b0.ptr, 0xAB, b0.size);
+    assert(allocator.committed_size() == alloc_t::commit_granularity);
+
+    auto b1 = allocator.allocate(1_MiB);
+    memset(b1.ptr, 0xCD, b1.size);
+    assert(allocator.committed_size() >= 1_MiB + 100);
+
+    // Growing the last block commits more memory
+    assert(allocator.reallocate(b1, 4_MiB));
+    memset(b1.ptr, 0xEF, 4_MiB);
+
+    allocator.deallocateAll();
+    assert(allocator.committed_size() == 0);
+
+    b0 = allocator.allocate(100);
+    assert(static_cast<uint8_t*>(b0.ptr)[0] == 0);
+}
+//--------------------------------------------------------------------------------------------------
+void test_hugepage_linear_allocator()
+{
+    using alloc_t = abb::hugepage_linear_allocator<3_MiB, 64_B>;
+    alloc_t allocator;
+
+    // Whatever the system gave us, we got something
+    assert(allocator.backing() != abb::PageBacking::None);
+
+    auto b0 = allocator.allocate(3_MiB);
+    assert(b0.size == 3_MiB);
+    assert(reinterpret_cast<uintptr_t>(b0.ptr) % 2_MiB == 0 || allocator.backing() == abb::PageBacking::RegularPages);
+    memset(b0.ptr, 0xAB, b0.size);
+
+    auto b1 = allocator.allocate(1);
+    assert(b1.ptr == nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_bitmapped_block()
+{
+    using alloc_t = abb::stack_bitmapped_block<32_B, 130>;
+    alloc_t allocator;
+
+    abb::block blocks[130];
+    for (auto &b : blocks)
+    {
+        b = allocator.allocate(20);
+        assert(b.size == 32);
+        assert(allocator.owns(b));
+    }
+
+    auto b0 = allocator.allocate(8);
+    assert(b0.ptr == nullptr);
+
+    auto b1 = allocator.allocate(64);
+    assert(b1.ptr == nullptr);
+
+    // Free blocks out of order, they must be reused
+    auto p70 = blocks[70].ptr;
+    auto p3  = blocks[3].ptr;
+    allocator.deallocate(blocks[70]);
+    allocator.deallocate(blocks[3]);
+
+    b0 = allocator.allocate(32);
+    assert(b0.ptr == p3);
+    b1 = allocator.allocate(1);
+    assert(b1.ptr == p70);
+
+    allocator.deallocateAll();
+    b0 = allocator.allocate(32);
+    assert(b0.ptr == blocks[0].ptr);
+}
+//--------------------------------------------------------------------------------------------------
+void test_buddy_allocator()
+{
+    // 16 bytes to 1 KiB blocks
+    using alloc_t = abb::stack_buddy_allocator<16_B, 6>;
+    alloc_t allocator;
+
+    auto b0 = allocator.allocate(100);
+    assert(b0.size == 128);
+    auto b1 = allocator.allocate(16);
+    assert(b1.size == 16);
+    auto b2 = allocator.allocate(512);
+    assert(b2.size == 512);
+
+    // b0 can't grow to 256 bytes, its buddy is where b1 lives
+    auto p0 = b0.ptr;
+    assert(allocator.reallocate(b0, 200));
+    assert(b0.size == 256 && b0.ptr != p0);
+
+    // Freeing everything coalesces back to the whole buffer
+    allocator.deallocate(b0);
+    allocator.deallocate(b1);
+    allocator.deallocate(b2);
+    auto b3 = allocator.allocate(1_KiB);
+    assert(b3.size == 1_KiB);
+    assert(allocator.allocate(16).ptr == nullptr);
+
+    // Shrink then grow back in place
+    assert(allocator.reallocate(b3, 64));
+    assert(b3.size == 64);
+    auto b4 = allocator.allocate(64);
+    assert(b4.ptr != nullptr);
+    allocator.deallocate(b4);
+    auto p3 = b3.ptr;
+    assert(allocator.reallocate(b3, 1_KiB));
+    assert(b3.ptr == p3 && b3.size == 1_KiB);
+
+    allocator.deallocateAll();
+    abb::block blocks[64];
+    for (auto &b : blocks)
+    {
+        b = allocator.allocate(1);
+        assert(b.ptr != nullptr);
+    }
+    for (size_t i = 0; i < 64; i += 2)
+    {
+        allocator.deallocate(blocks[i]);
+    }
+    assert(allocator.allocate(32).ptr == nullptr);
+    for (size_t i = 1; i < 64; i += 2)
+    {
+        allocator.deallocate(blocks[i]);
+    }
+    assert(allocator.allocate(1_KiB).ptr != nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_tlsf_allocator()
+{
+    using alloc_t = abb::stack_tlsf_allocator<64_KiB>;
+    alloc_t allocator;
+
+    auto b0 = allocator.allocate(100);
+    assert(b0.size == 112);
+    auto b1 = allocator.allocate(1);
+    assert(b1.size == 16);
+    auto b2 = allocator.allocate(5000);
+    assert(b2.size == 5008);
+    assert(allocator.owns(b0) && allocator.owns(b1) && allocator.owns(b2));
+
+    // b2 is followed by free space, it grows in place
+    auto p2 = b2.ptr;
+    assert(allocator.reallocate(b2, 10000));
+    assert(b2.ptr == p2 && b2.size == 10000);
+
+    // b0 can't grow in place, b1 follows it
+    auto p0 = b0.ptr;
+    assert(allocator.reallocate(b0, 200));
+    assert(b0.size == 208 && b0.ptr != p0);
+
+    // Freeing everything merges back to one block
+    allocator.deallocate(b0);
+    allocator.deallocate(b1);
+    allocator.deallocate(b2);
+    auto b3 = allocator.allocate(alloc_t::max_size);
+    assert(b3.size == alloc_t::max_size);
+    assert(allocator.allocate(1).ptr == nullptr);
+    allocator.deallocate(b3);
+
+    // Fragment the buffer, every other hole is too small for a bigger block
+    abb::block blocks[256];
+    for (auto &b : blocks)
+    {
+        b = allocator.allocate(128);
+        assert(b.ptr != nullptr);
+    }
+    for (size_t i = 0; i < 256; i += 2)
+    {
+        allocator.deallocate(blocks[i]);
+    }
+    auto b4 = allocator.allocate(256);
+    assert(b4.ptr > blocks[255].ptr);
+    allocator.deallocate(b4);
+    for (size_t i = 1; i < 256; i += 2)
+    {
+        allocator.deallocate(blocks[i]);
+    }
+    assert(allocator.allocate(alloc_t::max_size).ptr != nullptr);
+
+    allocator.deallocateAll();
+    assert(allocator.allocate(alloc_t::max_size).ptr != nullptr);
+
+    // A hole too small to be split is handed out whole, the block still has the requested size
+    // so that a segregator sends it back to the TLSF
+    using segregator_t = abb::segregator<256_B, alloc_t, abb::mallocator>;
+    segregator_t segregator;
+    auto b5 = segregator.allocate(128);
+    auto b6 = segregator.allocate(128);
+    auto b7 = segregator.allocate(16);
+    segregator.deallocate(b5);
+    segregator.deallocate(b6);
+    auto p5 = b5.ptr;
+    auto b8 = segregator.allocate(256);
+    assert(b8.ptr == p5 && b8.size == 256);
+    segregator.deallocate(b8);
+    segregator.deallocate(b7);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_slab_allocator()
+{
+    using slab_t  = abb::slab_allocator<abb::aligned_mallocator<4_KiB>, abb::range_t<33_B, 64_B>, 4_KiB, 1>;
+    slab_t allocator;
+
+    auto b0 = allocator.allocate(40);
+    assert(b0.size == 64 && allocator.owns(b0));
+    assert(allocator.allocate(32).ptr == nullptr);
+    assert(allocator.reallocate(b0, 50) && b0.size == 64);
+    allocator.deallocate(b0);
+
+    // Fill a few slabs
+    std::vector<abb::block> blocks;
+    for (size_t i = 0; i < 300; ++i)
+    {
+        blocks.push_back(allocator.allocate(64));
+        assert(blocks.back().ptr != nullptr);
+        *static_cast<size_t*>(blocks.back().ptr) = i;
+    }
+    const auto peakSlabCount = allocator.slabCount();
+    assert(peakSlabCount >= 300 * 64 / 4_KiB);
+
+    // Only one empty slab is kept once everything is freed
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        assert(*static_cast<size_t*>(blocks[i].ptr) == i);
+        allocator.deallocate(blocks[i]);
+    }
+    assert(allocator.slabCount() == 1);
+
+    // The slab set grows with the slabs, the blocks of released slabs aren't ours anymore
+    blocks.clear();
+    for (size_t i = 0; i < 40000; ++i)
+    {
+        blocks.push_back(allocator.allocate(64));
+    }
+    assert(allocator.slabCount() > 4_KiB / sizeof(uintptr_t));
+    for (size_t i = 0; i < blocks.size(); i += 2)
+    {
+        assert(allocator.owns(blocks[i]));
+        allocator.deallocate(blocks[i]);
+    }
+    for (size_t i = 1; i < blocks.size(); i += 2)
+    {
+        assert(allocator.owns(blocks[i]));
+        allocator.deallocate(blocks[i]);
+    }
+    size_t ownedCount = 0;
+    for (const auto &b : blocks)
+    {
+        ownedCount += allocator.owns(b) ? 1 : 0;
+    }
+    assert(allocator.slabCount() == 1 && ownedCount < 4_KiB / 64);
+
+    // Drop in replacement for freelist in a bucketizer
+    using bucket_t = abb::slab_allocator<abb::aligned_mallocator<4_KiB>, abb::dynamic_range_t, 4_KiB, 2>;
+    abb::bucketizer<bucket_t, abb::pow2_range_raider<16_B, 1_KiB>> bucketizer;
+    auto b1 = bucketizer.allocate(20);
+    assert(b1.size == 32 && bucketizer.owns(b1));
+    auto b2 = bucketizer.allocate(700);
+    assert(b2.size == 1_KiB && bucketizer.owns(b2));
+    bucketizer.deallocate(b1);
+    bucketizer.deallocate(b2);
+
+    // Foreign blocks are rejected without reading memory that isn't a slab
+    abb::mallocator mallocator;
+    auto b3 = mallocator.allocate(64);
+    assert(!allocator.owns(b3));
+    mallocator.deallocate(b3);
+    slab_t other;
+    auto b4 = other.allocate(64);
+    assert(other.owns(b4) && !allocator.owns(b4));
+    other.deallocate(b4);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_geometric_range_raider()
+{
+    using raider_t = abb::geometric_range_raider<16_B, 4_KiB, 4>;
+    static_assert(raider_t::num_steps == 32, "4 steps per power of 2");
+    static_assert(raider_t::step_index(16) == 0 && raider_t::step_index(20) == 0, "");
+    static_assert(raider_t::step_index(21) == 1 && raider_t::step_index(4_KiB) == 31, "");
+
+    // Every size falls in the step whose bounds are built the way bucketizer does
+    size_t stepMax = 16_B;
+    for (size_t i = 0; i < raider_t::num_steps; ++i)
+    {
+        const auto stepMin = stepMax + (i ? 1 : 0);
+        stepMax += raider_t::step_size(i);
+        for (size_t size = stepMin; size <= stepMax; ++size)
+        {
+            assert(raider_t::step_index(size) == i);
+            // Never more than 25% rounding
+            assert(4 * (stepMax - size) <= size);
+        }
+    }
+    assert(stepMax == 4_KiB);
+
+    using freelist_t = abb::freelist<abb::mallocator, abb::dynamic_range_t, 64, 8>;
+    abb::bucketizer<freelist_t, abb::geometric_range_raider<64_B, 2_KiB, 8>> bucketizer;
+    auto b = bucketizer.allocate(600);
+    assert(b.size == 640);
+    bucketizer.deallocate(b);
+    b = bucketizer.allocate(1000);
+    assert(b.size == 1024);
+    bucketizer.deallocate(b);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_fast_step_index()
+{
+    // The runtime bit scans give the same results as the constexpr versions
+    for (size_t v = 0; v < 100000; ++v)
+    {
+        assert(abb::fast_last_bit_set(v) == abb::last_bit_set(v));
+        assert(abb::fast_ceil_log2(v) == abb::last_bit_set(abb::next_pow2(v)));
+    }
+    for (size_t bit = 17; bit < 63; ++bit)
+    {
+        const auto v = size_t{ 1 } << bit;
+        assert(abb::fast_ceil_log2(v - 1) == abb::last_bit_set(abb::next_pow2(v - 1)));
+        assert(abb::fast_ceil_log2(v) == abb::last_bit_set(abb::next_pow2(v)));
+        assert(abb::fast_ceil_log2(v + 1) == abb::last_bit_set(abb::next_pow2(v + 1)));
+    }
+
+    using pow2_t      = abb::pow2_range_raider<16_B, 64_KiB>;
+    using geometric_t = abb::geometric_range_raider<16_B, 64_KiB, 8>;
+    for (size_t size = 16_B; size <= 64_KiB; ++size)
+    {
+        assert(pow2_t::fast_step_index(size) == pow2_t::step_index(size));
+        assert(geometric_t::fast_step_index(size) == geometric_t::step_index(size));
+    }
+    assert(pow2_t::step_index(16_B) == 0);
+    assert(pow2_t::fast_step_index(16_B) == 0);
+    assert(geometric_t::fast_step_index(8) == abb::invalid_index);
+    assert(geometric_t::fast_step_index(64_KiB + 1) == abb::invalid_index);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_batch_allocation()
+{
+    abb::block blocks[64];
+
+    // One bump for the whole batch, and the whole batch can be rewound
+    abb::stack_linear_allocator<1_KiB> linearAllocator;
+    assert(abb::allocate_n(linearAllocator, 20, blocks, 8) == 8);
+    for (size_t i = 1; i < 8; ++i)
+    {
+        assert(blocks[i].size == 24);
+        assert(static_cast<uint8_t*>(blocks[i].ptr) == static_cast<uint8_t*>(blocks[i - 1].ptr) + 24);
+    }
+    abb::deallocate_n(linearAllocator, blocks, 8);
+    assert(abb::allocate_n(linearAllocator, 1_KiB, blocks, 2) == 1);
+    linearAllocator.deallocateAll();
+
+    // Blocks popped from the list, populated as many times as needed
+    using freelist_t = abb::freelist<abb::mallocator, abb::range_t<32_B, 64_B>, 16, 8>;
+    freelist_t freelist;
+    assert(abb::allocate_n(freelist, 40, blocks, 20) == 20);
+    for (size_t i = 0; i < 20; ++i)
+    {
+        assert(blocks[i].ptr != nullptr && blocks[i].size == 64);
+    }
+    abb::deallocate_n(freelist, blocks, 20);
+
+    // The bucket is resolved once, blocks of mixed sizes go back to their bucket
+    using bucket_t = abb::freelist<abb::mallocator, abb::dynamic_range_t, 16, 4>;
+    abb::bucketizer<bucket_t, abb::pow2_range_raider<16_B, 1_KiB>> bucketizer;
+    assert(abb::allocate_n(bucketizer, 100, blocks, 10) == 10);
+    assert(abb::allocate_n(bucketizer, 500, blocks + 10, 10) == 10);
+    assert(blocks[0].size == 128 && blocks[10].size == 512);
+    abb::deallocate_n(bucketizer, blocks, 20);
+    assert(abb::allocate_n(bucketizer, 2_KiB, blocks, 10) == 0);
+
+    // What the primary can't provide comes from the fallback, and the lock is taken once
+    using fallback_t = abb::fallback_allocator<abb::stack_linear_allocator<256_B>, abb::heap_linear_allocator<1_KiB>>;
+    abb::locked_allocator<fallback_t> fallback;
+    assert(abb::allocate_n(fallback, 64, blocks, 10) == 10);
+    assert(fallback.owns(blocks[3]) && !static_cast<abb::stack_linear_allocator<256_B>&>(fallback).owns(blocks[4]));
+    abb::deallocate_n(fallback, blocks, 10);
+
+    // Loop fallback for allocators without a batch interface
+    abb::mallocator mallocator;
+    assert(abb::allocate_n(mallocator, 32, blocks, 64) == 64);
+    abb::deallocate_n(mallocator, blocks, 64);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_expand()
+{
+    static_assert(abb::supports_expand<abb::stack_linear_allocator<1_KiB>>(), "");
+    static_assert(!abb::supports_expand<abb::mallocator>(), "");
+
+    // Only the last block of a linear allocator can grow
+    abb::stack_linear_allocator<1_KiB> linearAllocator;
+    auto b0 = linearAllocator.allocate(64);
+    auto b1 = linearAllocator.allocate(64);
+    assert(!abb::expand(linearAllocator, b0, 8));
+    assert(abb::expand(linearAllocator, b1, 100) && b1.size == 168);
+    assert(!abb::expand(linearAllocator, b1, 1_KiB));
+    linearAllocator.deallocateAll();
+
+    // Buddies and TLSF neighbours
+    abb::stack_buddy_allocator<16_B, 6> buddyAllocator;
+    auto b2 = buddyAllocator.allocate(64);
+    assert(abb::expand(buddyAllocator, b2, 64) && b2.size == 128);
+    auto b3 = buddyAllocator.allocate(128);
+    assert(!abb::expand(buddyAllocator, b2, 1));
+
+    abb::stack_tlsf_allocator<64_KiB> tlsfAllocator;
+    auto b4 = tlsfAllocator.allocate(64);
+    auto p4 = b4.ptr;
+    assert(abb::expand(tlsfAllocator, b4, 1000) && b4.ptr == p4 && b4.size == 1072);
+    auto b5 = tlsfAllocator.allocate(64);
+    assert(!abb::expand(tlsfAllocator, b4, 16));
+    tlsfAllocator.deallocate(b5);
+    assert(abb::expand(tlsfAllocator, b4, 16));
+
+    // Forwarded through the compositors, the suffix follows the end of the block
+    using affix_t = abb::affix_allocator<abb::stack_linear_allocator<1_KiB>, size_t, size_t>;
+    affix_t affixAllocator;
+    auto b6 = affixAllocator.allocate(32);
+    *affixAllocator.suffix(b6) = 0xC0FFEE;
+    assert(abb::expand(affixAllocator, b6, 32) && b6.size == 64);
+    assert(*affixAllocator.suffix(b6) == 0xC0FFEE);
+
+    using fallback_t = abb::fallback_allocator<abb::stack_linear_allocator<128_B>, abb::heap_linear_allocator<1_KiB>>;
+    fallback_t fallbackAllocator;
+    auto b7 = fallbackAllocator.allocate(128);
+    auto b8 = fallbackAllocator.allocate(128);
+    assert(!abb::expand(fallbackAllocator, b7, 8));
+    assert(abb::expand(fallbackAllocator, b8, 8) && b8.size == 136);
+
+    using cascading_t = abb::cascading_allocator<abb::heap_linear_allocator<1_KiB>>;
+    cascading_t cascadingAllocator;
+    auto b9 = cascadingAllocator.allocate(64);
+    assert(abb::expand(cascadingAllocator, b9, 64) && b9.size == 128);
+
+    // The freelist's blocks are already as big as they can be
+    using freelist_t = abb::freelist<abb::mallocator, abb::range_t<32_B, 64_B>, 16, 4>;
+    freelist_t freelist;
+    auto b10 = freelist.allocate(40);
+    assert(abb::expand(freelist, b10, 0) && !abb::expand(freelist, b10, 8));
+    freelist.deallocate(b10);
+
+    // A buddy doubles its blocks, they must not grow past the segregator's threshold
+    using segregator_t = abb::segregator<128_B, abb::stack_buddy_allocator<16_B, 6>, abb::mallocator>;
+    segregator_t segregator;
+    auto b11 = segregator.allocate(64);
+    assert(!abb::expand(segregator, b11, 70) && b11.size == 64);
+    assert(abb::expand(segregator, b11, 30) && b11.size == 128);
+    auto b12 = segregator.allocate(16);
+    assert(abb::expand(segregator, b12, 16) && b12.size == 32);
+    segregator.deallocate(b11);
+    segregator.deallocate(b12);
+
+    buddyAllocator.deallocate(b2);
+    buddyAllocator.deallocate(b3);
+    tlsfAllocator.deallocate(b4);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_good_size()
+{
+    // Alignment rounding
+    abb::stack_linear_allocator<1_KiB, 16_B> linearAllocator;
+    static_assert(abb::stack_linear_allocator<1_KiB, 16_B>::good_size(20) == 32, "");
+    auto b0 = abb::allocate_at_least(linearAllocator, 20);
+    assert(b0.size == abb::good_size(linearAllocator, 20));
+
+    // The whole freelist block
+    using freelist_t = abb::freelist<abb::mallocator, abb::range_t<33_B, 64_B>, 16, 4>;
+    freelist_t freelist;
+    assert(abb::good_size(freelist, 40) == 64);
+    assert(abb::good_size(freelist, 100) == 104);
+    auto b1 = abb::allocate_at_least(freelist, 40);
+    assert(b1.size == 64);
+    freelist.deallocate(b1);
+
+    // The bucket's upper bound
+    using bucket_t = abb::freelist<abb::mallocator, abb::dynamic_range_t, 16, 4>;
+    abb::bucketizer<bucket_t, abb::geometric_range_raider<64_B, 2_KiB, 4>> bucketizer;
+    assert(abb::good_size(bucketizer, 600) == 640);
+    auto b2 = abb::allocate_at_least(bucketizer, 600);
+    assert(b2.size == 640);
+    bucketizer.deallocate(b2);
+
+    // Each side of the threshold
+    using segregator_t = abb::segregator<64_B, freelist_t, abb::stack_linear_allocator<1_KiB>>;
+    segregator_t segregator;
+    assert(abb::good_size(segregator, 40) == 64);
+    assert(abb::good_size(segregator, 100) == 104);
+
+    // Allocators that can't tell give the size itself
+    abb::mallocator mallocator;
+    assert(abb::good_size(mallocator, 13) == 13);
+
+    abb::stack_buddy_allocator<16_B, 6> buddyAllocator;
+    assert(abb::good_size(buddyAllocator, 100) == 128);
+    abb::stack_tlsf_allocator<64_KiB> tlsfAllocator;
+    assert(abb::good_size(tlsfAllocator, 100) == 112);
+
+    using affix_t = abb::affix_allocator<abb::stack_linear_allocator<1_KiB>, uint32_t>;
+    affix_t affixAllocator;
+    assert(abb::good_size(affixAllocator, 13) == 16);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_aligned_allocation()
+{
+    const auto isAligned = [](const abb::block &b, size_t alignment) { return abb::is_aligned(reinterpret_cast<uintptr_t>(b.ptr), alignment); };
+
+    // Padded cursor
+    abb::stack_linear_allocator<16_KiB> linearAllocator;
+    auto b0 = linearAllocator.allocate(8);
+    assert(b0.ptr && linearAllocator.owns(b0));
+    auto b1 = abb::allocate_aligned(linearAllocator, 100, 64_B);
+    assert(b1.ptr && isAligned(b1, 64_B) && linearAllocator.owns(b1));
+    auto b2 = abb::allocate_aligned(linearAllocator, 100, 4_KiB);
+    assert(b2.ptr && isAligned(b2, 4_KiB) && linearAllocator.owns(b2));
+    linearAllocator.deallocateAll();
+
+    // posix_memalign or _aligned_malloc
+    abb::mallocator mallocator;
+    auto b3 = abb::allocate_aligned(mallocator, 100, 8_B);
+    assert(b3.ptr);
+    mallocator.deallocate(b3);
+#if !defined(_WIN32)
+    auto b4 = abb::allocate_aligned(mallocator, 100, 4_KiB);
+    assert(b4.ptr && isAligned(b4, 4_KiB));
+    mallocator.deallocate(b4);
+#endif
+
+    // Aligned blocks join the freelist once deallocated
+    using freelist_t = abb::freelist<abb::stack_linear_allocator<16_KiB>, abb::range_t<33_B, 64_B>, 16, 4>;
+    freelist_t freelist;
+    auto b5 = abb::allocate_aligned(freelist, 40, 256_B);
+    assert(b5.ptr && b5.size == 64 && isAligned(b5, 256_B));
+    freelist.deallocate(b5);
+    auto b6 = abb::allocate_aligned(freelist, 40, 256_B);
+    assert(b6.ptr == b5.ptr);
+    freelist.deallocate(b6);
+
+    // Through the bucket of the size
+    using bucket_t = abb::freelist<abb::stack_linear_allocator<16_KiB>, abb::dynamic_range_t, 16, 4>;
+    abb::bucketizer<bucket_t, abb::pow2_range_raider<16_B, 1_KiB>> bucketizer;
+    auto b7 = abb::allocate_aligned(bucketizer, 100, 128_B);
+    assert(b7.ptr && isAligned(b7, 128_B));
+    bucketizer.deallocate(b7);
+
+    // Pass-through compositors
+    abb::locked_allocator<abb::stack_linear_allocator<16_KiB>> lockedAllocator;
+    auto b8 = abb::allocate_aligned(lockedAllocator, 100, 1_KiB);
+    assert(b8.ptr && isAligned(b8, 1_KiB));
+    lockedAllocator.deallocate(b8);
+
+    abb::fallback_allocator<abb::stack_linear_allocator<1_KiB>, abb::stack_linear_allocator<16_KiB>> fallbackAllocator;
+    auto b9 = abb::allocate_aligned(fallbackAllocator, 900, 512_B);
+    assert(b9.ptr && isAligned(b9, 512_B));
+    fallbackAllocator.deallocate(b9);
+
+    // A failed aligned allocation isn't stripped into a bogus block
+    abb::affix_allocator<abb::stack_linear_allocator<1_KiB>, std::array<uint8_t, 64>> affixAllocator;
+    auto b10 = abb::allocate_aligned(affixAllocator, 2_KiB, 64_B);
+    assert(b10.ptr == nullptr && b10.size == 0);
+
+    // Static alignment only
+    abb::stack_tlsf_allocator<64_KiB> tlsfAllocator;
+    static_assert(!abb::supports_allocate_aligned<abb::stack_tlsf_allocator<64_KiB>>(), "");
+    assert(abb::allocate_aligned(tlsfAllocator, 100, 4_KiB).ptr == nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_stats_collector()
+{
+    using freelist_t = abb::freelist<abb::stack_linear_allocator<4_KiB>, abb::range_t<33_B, 64_B>, 16, 4>;
+    abb::stats_collector<freelist_t> allocator;
+
+    auto b0 = allocator.allocate(40);
+    auto b1 = allocator.allocate(100);
+    auto b2 = allocator.allocate(8_KiB);
+    assert(b2.ptr == nullptr);
+    assert(allocator.owns(b0));
+
+    // Grows in place at the end of the linear allocator
+    assert(allocator.expand(b1, 100) && allocator.stats().inPlaceReallocations == 1);
+    // Moves out of the freelist
+    assert(allocator.reallocate(b0, 100) && allocator.stats().copiedReallocations() == 1);
+    // Only counts as a failure
+    assert(!allocator.expand(b1, 8_KiB));
+    assert(allocator.stats().reallocations == 2 && allocator.stats().copiedReallocations() == 1);
+
+    const auto &stats = allocator.stats();
+    assert(stats.allocations == 2);
+    assert(stats.failures == 2);
+    assert(stats.ownsCalls >= 1);
+    assert(stats.bytesLive == b0.size + b1.size);
+    assert(stats.bytesPeak >= stats.bytesLive);
+    assert(stats.histogram[5] == 1);
+    assert(stats.histogram[6] == 1);
+    // Failed requests stay out of the histogram
+    assert(stats.histogram[13] == 0);
+
+    allocator.deallocate(b0);
+    allocator.deallocate(b1);
+    assert(stats.deallocations == 2);
+    assert(stats.bytesLive == 0);
+
+    // Batches count each block
+    abb::block blocks[4];
+    assert(allocator.allocate_n(48, blocks, 4) == 4);
+    assert(stats.allocations == 6 && stats.bytesLive == 4 * 64);
+    allocator.deallocate_n(blocks, 4);
+    assert(stats.deallocations == 6 && stats.bytesLive == 0);
+
+    allocator.resetStats();
+    assert(stats.allocations == 0 && stats.bytesPeak == 0);
+
+    // Disabled counters are left untouched
+    abb::stats_collector<abb::mallocator, abb::count_allocations> mallocator;
+    auto b3 = mallocator.allocate(16);
+    mallocator.deallocate(b3);
+    assert(mallocator.stats().allocations == 1);
+    assert(mallocator.stats().deallocations == 0);
+    assert(mallocator.stats().bytesPeak == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_sharded_stats()
+{
+    constexpr size_t threadCount            = 8;
+    constexpr size_t allocationsPerThread   = 1000;
+
+    abb::stats_collector<abb::mallocator, abb::all_stats, abb::sharded_stats<16>> allocator;
+
+    // Every thread frees half of its blocks and leaves the other half to the main thread
+    std::vector<abb::block> blocks(threadCount * allocationsPerThread);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&allocator, &blocks, t]
+        {
+            for (size_t i = 0; i < allocationsPerThread; ++i)
+            {
+                auto &b = blocks[t * allocationsPerThread + i];
+                b = allocator.allocate(16 * (1 + (i & 3)));
+                if (i & 1)
+                {
+                    allocator.deallocate(b);
+                }
+            }
+        });
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    auto stats = allocator.stats();
+    assert(stats.allocations == threadCount * allocationsPerThread);
+    assert(stats.deallocations == threadCount * allocationsPerThread / 2);
+    assert(stats.bytesLive == threadCount * (allocationsPerThread / 4) * (16 + 48));
+    assert(stats.histogram[4] == threadCount * allocationsPerThread / 4);
+    assert(stats.histogram[5] == threadCount * allocationsPerThread / 2);
+    assert(stats.bytesPeak == stats.bytesLive);
+
+    for (size_t i = 0; i < blocks.size(); i += 2)
+    {
+        allocator.deallocate(blocks[i]);
+    }
+    stats = allocator.stats();
+    assert(stats.deallocations == stats.allocations);
+    assert(stats.bytesLive == 0);
+    assert(stats.bytesPeak == threadCount * (allocationsPerThread / 4) * (16 + 48));
+
+    allocator.resetStats();
+    assert(allocator.stats().allocations == 0);
+    assert(allocator.stats().bytesPeak == 0);
+
+    // More live threads than shards, the last ones share a shard without losing any update
+    abb::stats_collector<abb::mallocator, abb::all_stats, abb::sharded_stats<2>> fewShards;
+    std::atomic<size_t> startedCount{ 0 };
+    threads.clear();
+    for (size_t t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&fewShards, &startedCount]
+        {
+            // Every thread holds its slot until all of them are live
+            auto b = fewShards.allocate(16);
+            ++startedCount;
+            while (startedCount.load() < threadCount)
+            {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < allocationsPerThread; ++i)
+            {
+                auto other = fewShards.allocate(32);
+                fewShards.deallocate(other);
+            }
+            fewShards.deallocate(b);
+        });
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+    stats = fewShards.stats();
+    assert(stats.allocations == threadCount * (allocationsPerThread + 1));
+    assert(stats.deallocations == stats.allocations);
+    assert(stats.bytesLive == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_trace_recorder()
+{
+    const char *tracePath = "abb_test_trace.bin";
+
+    abb::trace_recorder<abb::mallocator, 2> allocator;
+
+    // Not recorded yet
+    auto b0 = allocator.allocate(8);
+    allocator.deallocate(b0);
+
+    assert(allocator.startRecording(tracePath));
+    auto b1 = allocator.allocate(100);
+    auto b2 = allocator.allocate(200);
+    const auto b1Id = reinterpret_cast<uintptr_t>(b1.ptr);
+    allocator.reallocate(b1, 1000);
+    allocator.deallocate(b2);
+    allocator.deallocate(b1);
+    allocator.stopRecording();
+
+    std::vector<abb::trace_event> events;
+    assert(abb::read_trace(tracePath, events));
+    assert(events.size() == 6);
+    assert(events[0].type == abb::TraceEventType::Allocate && events[0].size == 100 && events[0].blockId == b1Id);
+    assert(events[1].type == abb::TraceEventType::Allocate && events[1].size == 200);
+    assert(events[2].type == abb::TraceEventType::Reallocate && events[2].blockId == b1Id && events[2].size == 1000);
+    assert(events[3].type == abb::TraceEventType::Reallocated && events[3].blockId == b1Id && events[3].newBlockId == reinterpret_cast<uintptr_t>(b1.ptr));
+    assert(events[4].type == abb::TraceEventType::Deallocate && events[4].blockId == events[1].blockId);
+    assert(events[5].type == abb::TraceEventType::Deallocate && events[5].blockId == events[3].newBlockId);
+    assert(events[0].timestamp <= events[5].timestamp);
+
+    // Each thread buffers its events, the whole trace is ordered once read
+    assert(allocator.startRecording(tracePath));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&allocator]
+        {
+            for (int i = 0; i < 100; ++i)
+            {
+                auto b = allocator.allocate(64);
+                allocator.reallocate(b, 128);
+                allocator.deallocate(b);
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    allocator.stopRecording();
+
+    events.clear();
+    assert(abb::read_trace(tracePath, events));
+    assert(events.size() == 4 * 100 * 4);
+    assert(std::is_sorted(events.begin(), events.end(), [](const abb::trace_event &lhs, const abb::trace_event &rhs) { return lhs.timestamp < rhs.timestamp; }));
+
+    // No address is taken while it is still live
+    std::unordered_map<uint64_t, size_t> liveBlocks;
+    for (const auto &event : events)
+    {
+        switch (event.type)
+        {
+        case abb::TraceEventType::Allocate:
+            assert(liveBlocks.count(event.blockId) == 0);
+            liveBlocks[event.blockId] = event.size;
+            break;
+        case abb::TraceEventType::Reallocate:
+        case abb::TraceEventType::Deallocate:
+            assert(liveBlocks.erase(event.blockId) == 1);
+            break;
+        case abb::TraceEventType::Reallocated:
+            assert(liveBlocks.count(event.newBlockId) == 0);
+            liveBlocks[event.newBlockId] = event.size;
+            break;
+        case abb::TraceEventType::DeallocateAll:
+            break;
+        }
+    }
+    assert(liveBlocks.empty());
+
+    std::remove(tracePath);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_stl_allocator()
+{
+    using small_t       = abb::freelist<abb::mallocator, abb::range_t<0, 16_B>, 1024, 16>;
+    using freelist_t    = abb::freelist<abb::mallocator, abb::dynamic_range_t, 1024, 16>;
+    using pool_t        = abb::segregator<16_B, small_t, abb::bucketizer<freelist_t, abb::pow2_range_raider<16_B, 16_KiB>>>;
+    using alloc_t       = abb::stats_collector<pool_t>;
+    alloc_t allocator;
+
+    {
+        abb::stl_allocator<int, alloc_t> stlAllocator(allocator);
+
+        // Blocks go back to their freelist, which gives them again right away
+        auto p0 = stlAllocator.allocate(10);
+        stlAllocator.deallocate(p0, 10);
+        auto p1 = stlAllocator.allocate(12);
+        assert(p1 == p0);
+        stlAllocator.deallocate(p1, 12);
+
+        std::vector<int, abb::stl_allocator<int, alloc_t>> v(stlAllocator);
+        for (int i = 0; i < 1000; ++i)
+        {
+            v.push_back(i);
+        }
+
+        std::list<int, abb::stl_allocator<int, alloc_t>> l(stlAllocator);
+        for (int i = 0; i < 1000; ++i)
+        {
+            l.push_back(i);
+        }
+        l.remove_if([](int i) { return i % 2 == 0; });
+        assert(l.size() == 500);
+
+        using map_allocator_t = abb::stl_allocator<std::pair<const int, int>, alloc_t>;
+        std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, map_allocator_t> m(16, std::hash<int>(), std::equal_to<int>(), map_allocator_t(allocator));
+        for (int i = 0; i < 1000; ++i)
+        {
+            m[i] = i;
+        }
+        m.erase(42);
+        assert(m.size() == 999);
+
+        // Rebound allocators refer to the same allocator
+        assert(m.get_allocator() == stlAllocator);
+        assert(&l.get_allocator().allocator() == &allocator);
+        assert(allocator.stats().allocations > 2000);
+    }
+
+    // Every block was given back with the size it was allocated with
+    assert(allocator.stats().deallocations == allocator.stats().allocations);
+    assert(allocator.stats().bytesLive == 0);
+
+    // Default constructed ones share an instance
+    using shared_t = abb::stl_allocator<int, pool_t>;
+    shared_t a0;
+    abb::stl_allocator<double, pool_t> a1;
+    assert(a0 == a1);
+    assert(&a0.allocator() == &shared_t::sharedAllocator());
+    using counted_t = abb::stl_allocator<int, alloc_t>;
+    assert(counted_t(allocator) != counted_t());
+    std::vector<double, abb::stl_allocator<double, pool_t>> v(100, 1.0);
+    assert(v[99] == 1.0);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_memory_resource()
+{
+    using small_t       = abb::freelist<abb::mallocator, abb::range_t<0, 16_B>, 1024, 16>;
+    using freelist_t    = abb::freelist<abb::mallocator, abb::dynamic_range_t, 1024, 16>;
+    using pool_t        = abb::segregator<16_B, small_t, abb::bucketizer<freelist_t, abb::pow2_range_raider<16_B, 16_KiB>>>;
+    abb::memory_resource<abb::stats_collector<pool_t>> pool;
+    {
+        std::pmr::vector<int> v(&pool);
+        std::pmr::list<int> l(&pool);
+        for (int i = 0; i < 1000; ++i)
+        {
+            v.push_back(i);
+            l.push_back(i);
+        }
+        assert(pool.allocator().stats().allocations > 1000);
+        assert(pool.is_equal(pool));
+    }
+    // Every block was given back with the size it was allocated with
+    assert(pool.allocator().stats().bytesLive == 0);
+
+    abb::memory_resource<abb::stack_linear_allocator<1_KiB, 16>> arena;
+    assert(!arena.is_equal(pool));
+
+    // Over-aligned, the cursor is padded
+    auto p0 = arena.allocate(8, 8);
+    auto p1 = arena.allocate(100, 64);
+    assert(reinterpret_cast<uintptr_t>(p1) % 64 == 0);
+
+    bool failed = false;
+    try
+    {
+        (void)arena.allocate(2_KiB);
+    }
+    catch (const std::bad_alloc &)
+    {
+        failed = true;
+    }
+    assert(failed);
+
+    // Everything is given back at once
+    arena.release();
+    assert(arena.allocate(8, 8) == p0);
+    (void)p1;
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_cascading_allocator()
+{
+    using alloc_t = abb::cascading_allocator<abb::heap_linear_allocator<1_KiB>>;
+    alloc_t allocator;
+
+    // The address index alone tells whether a linear allocator node owns a block
+    static_assert(abb::is_buffer_backed<abb::heap_linear_allocator<1_KiB>>::value, "");
+    static_assert(!abb::is_buffer_backed<abb::mallocator>::value, "");
+
+    // Each block is too big to share a node with another one
+    abb::block blocks[64];
+    for (auto &b : blocks)
+    {
+        b = allocator.allocate(512);
+        assert(b.ptr != nullptr);
+    }
+
+    for (auto &b : blocks)
+    {
+        assert(allocator.owns(b));
+    }
+
+    abb::mallocator m;
+    auto foreign = m.allocate(16);
+    assert(!allocator.owns(foreign));
+    m.deallocate(foreign);
+
+    // Freeing the last block of a node rewinds that node so it can be reused
+    auto p = blocks[17].ptr;
+    allocator.deallocate(blocks[17]);
+    auto b = allocator.allocate(512);
+    assert(b.ptr == p);
+
+    allocator.deallocateAll();
+    b = allocator.allocate(512);
+    assert(allocator.owns(b));
+
+    // A freelist node may own blocks of another node, its owner is found by walking the list
+    using freelist_t = abb::freelist<abb::heap_linear_allocator<4_KiB>, abb::range_t<1, 64>, 16, 8>;
+    static_assert(!abb::is_buffer_backed<freelist_t>::value, "");
+    abb::cascading_allocator<freelist_t> freelistAllocator;
+    abb::block freelistBlocks[40];
+    for (size_t i = 0; i < 40; ++i)
+    {
+        freelistBlocks[i] = freelistAllocator.allocate(i % 2 ? 64 : 1_KiB);
+        if (i % 3 == 0)
+        {
+            freelistAllocator.deallocate(freelistBlocks[i]);
+            freelistBlocks[i] = freelistAllocator.allocate(i % 2 ? 64 : 1_KiB);
+        }
+    }
+    for (auto &fb : freelistBlocks)
+    {
+        assert(fb.ptr && freelistAllocator.owns(fb));
+    }
+    for (auto &fb : freelistBlocks)
+    {
+        freelistAllocator.deallocate(fb);
+    }
+
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_thread_cache()
+{
+    using freelist_t = abb::freelist<abb::mallocator, abb::dynamic_range_t, 64, 8>;
+    using shared_t   = abb::locked_allocator<abb::bucketizer<freelist_t, abb::pow2_range_raider<16_B, 1_KiB>>>;
+    using alloc_t    = abb::thread_cache<shared_t, abb::pow2_range_raider<16_B, 1_KiB>, 16>;
+    alloc_t allocator;
+
+    auto b0 = allocator.allocate(20);
+    assert(b0.size == 32);
+    auto p0 = b0.ptr;
+    allocator.deallocate(b0);
+
+    // The block comes back from the thread's cache
+    b0 = allocator.allocate(30);
+    assert(b0.ptr == p0);
+    allocator.deallocate(b0);
+
+    // Sizes out of the cached range go straight to the shared allocator
+    auto b1 = allocator.allocate(4_KiB);
+    assert(b1.ptr == nullptr);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&allocator]
+        {
+            abb::block blocks[100];
+            for (int i = 0; i < 1000; ++i)
+            {
+                for (size_t j = 0; j < 100; ++j)
+                {
+                    blocks[j] = allocator.allocate(17 + j * 9);
+                    assert(blocks[j].ptr != nullptr);
+                    *static_cast<size_t*>(blocks[j].ptr) = j;
+                }
+                for (size_t j = 0; j < 100; ++j)
+                {
+                    assert(*static_cast<size_t*>(blocks[j].ptr) == j);
+                    allocator.deallocate(blocks[j]);
+                }
+            }
+        });
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_concurrent_freelist()
+{
+    using alloc_t = abb::concurrent_freelist<abb::mallocator, abb::range_t<32_B, 64_B>, 128, 16>;
+    alloc_t allocator;
+
+    auto b0 = allocator.allocate(40);
+    assert(b0.size == 64);
+    auto p0 = b0.ptr;
+    allocator.deallocate(b0);
+    b0 = allocator.allocate(64);
+    assert(b0.ptr == p0);
+    allocator.deallocate(b0);
+
+    // Blocks allocated by a thread and freed by another one
+    std::vector<abb::block> shared(10000);
+    std::thread producer([&]
+    {
+        for (auto &b : shared)
+        {
+            b = allocator.allocate(48);
+            assert(b.ptr != nullptr);
+        }
+    });
+    producer.join();
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&allocator, &shared, t]
+        {
+            for (size_t i = t; i < shared.size(); i += 4)
+            {
+                allocator.deallocate(shared[i]);
+                auto b = allocator.allocate(33);
+                *static_cast<size_t*>(b.ptr) = i;
+                auto c = allocator.allocate(60);
+                *static_cast<size_t*>(c.ptr) = i + 1;
+                assert(*static_cast<size_t*>(b.ptr) == i);
+                allocator.deallocate(c);
+                allocator.deallocate(b);
+            }
+        });
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_concurrent_linear_allocator()
+{
+    using alloc_t = abb::concurrent_heap_linear_allocator<1_MiB, 8_B, abb::mallocator, 4_KiB>;
+    alloc_t allocator;
+
+    auto b0 = allocator.allocate(16);
+    auto b1 = allocator.allocate(16);
+    assert(static_cast<uint8_t*>(b1.ptr) == static_cast<uint8_t*>(b0.ptr) + 16);
+
+    // The last block of the lease can be reclaimed
+    allocator.deallocate(b1);
+    b1 = allocator.allocate(32);
+    assert(static_cast<uint8_t*>(b1.ptr) == static_cast<uint8_t*>(b0.ptr) + 16);
+
+    // Bigger than a lease, straight from the shared cursor
+    auto b2 = allocator.allocate(8_KiB);
+    assert(b2.size == 8_KiB && allocator.owns(b2));
+
+    allocator.deallocateAll();
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&allocator, t]
+        {
+            std::vector<abb::block> blocks;
+            for (size_t i = 0; i < 1000; ++i)
+            {
+                auto b = allocator.allocate(24 + (i % 7) * 8);
+                assert(b.ptr != nullptr);
+                memset(b.ptr, static_cast<int>(t), b.size);
+                blocks.push_back(b);
+            }
+            for (auto &b : blocks)
+            {
+                for (size_t i = 0; i < b.size; ++i)
+                {
+                    assert(static_cast<uint8_t*>(b.ptr)[i] == t);
+                }
+            }
+        });
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    // Leases are invalidated, everything is available again
+    allocator.deallocateAll();
+    auto b3 = allocator.allocate(1_MiB);
+    assert(b3.ptr != nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_concurrent_linear_allocator_fetch_add()
+{
+    using alloc_t = abb::concurrent_stack_linear_allocator<128_B, 8_B, 0, abb::BumpMode::FetchAdd>;
+    alloc_t allocator;
+
+    auto b0 = allocator.allocate(64);
+    assert(b0.size == 64);
+    auto b1 = allocator.allocate(48);
+    assert(b1.size == 48);
+
+    // Doesn't fit, the overshoot is lost and the buffer is exhausted
+    auto b2 = allocator.allocate(24);
+    assert(b2.ptr == nullptr);
+    assert(allocator.exhausted());
+    b2 = allocator.allocate(8);
+    assert(b2.ptr == nullptr);
+
+    allocator.deallocateAll();
+    assert(!allocator.exhausted());
+    b2 = allocator.allocate(128);
+    assert(b2.ptr == b0.ptr);
+
+    // Filled exactly, without any overshoot
+    assert(allocator.exhausted());
+    assert(allocator.allocate(8).ptr == nullptr);
+}
 
 
 //--------------------------------------------------------------------------------------------------
 int main()
 {
     test_linear_allocator();
+    test_virtual_linear_allocator();
+    test_hugepage_linear_allocator();
+    test_bitmapped_block();
+    test_buddy_allocator();
+    test_tlsf_allocator();
+    test_slab_allocator();
+    test_geometric_range_raider();
+    test_fast_step_index();
+    test_batch_allocation();
+    test_expand();
+    test_good_size();
+    test_aligned_allocation();
+    test_stats_collector();
+    test_sharded_stats();
+    test_trace_recorder();
+    test_stl_allocator();
+    test_memory_resource();
+    test_cascading_allocator();
+    test_thread_cache();
+    test_concurrent_freelist();
+    test_concurrent_linear_allocator();
+    test_concurrent_linear_allocator_fetch_add();
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file